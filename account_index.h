@@ -0,0 +1,183 @@
+#ifndef ACCOUNT_INDEX_H
+#define ACCOUNT_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// ----------------------------Account number index--------------------------------
+//
+// Account numbers from generateAccountNumber() are "MDBSCE" followed by decimal
+// digits. Such a number is packed into one 64-bit key (digit count in the top byte,
+// value below it, so "MDBSCE0042" and "MDBSCE42" stay distinct) and stored in a flat
+// open-addressing table with linear probing: a lookup is a parse, a hash and usually
+// a single cache line. Numbers that do not follow the pattern live in a fallback
+// unordered_map.
+
+namespace Banking
+{
+    const char accountNumberPrefix[] = "MDBSCE";
+    const size_t accountNumberPrefixLength = sizeof(accountNumberPrefix) - 1;
+
+    // Pack a conforming account number into a non-zero key; false for anything else
+    inline bool parseAccountKey(const std::string& accNum, uint64_t& key)
+    {
+        if (accNum.size() <= accountNumberPrefixLength ||
+            accNum.size() - accountNumberPrefixLength > 15 ||
+            accNum.compare(0, accountNumberPrefixLength, accountNumberPrefix) != 0) {
+            return false;
+        }
+        size_t digits = accNum.size() - accountNumberPrefixLength;
+        uint64_t value = 0;
+        for (size_t i = accountNumberPrefixLength; i < accNum.size(); i++) {
+            unsigned d = static_cast<unsigned>(accNum[i] - '0');
+            if (d > 9) return false;
+            value = value * 10 + d;
+        }
+        key = (static_cast<uint64_t>(digits) << 56) | value;
+        return true;
+    }
+
+    template<typename V>
+    class AccountIndex
+    {
+    private:
+        struct Slot
+        {
+            uint64_t key;       // 0 marks an empty slot
+            V value;
+        };
+
+        std::vector<Slot> slots;
+        size_t count;
+        size_t mask;
+        std::unordered_map<std::string, V> fallback;
+
+        static uint64_t mix(uint64_t key)
+        {
+            // splitmix64 finalizer, spreads consecutive account numbers over the table
+            key ^= key >> 30;
+            key *= 0xbf58476d1ce4e5b9ULL;
+            key ^= key >> 27;
+            key *= 0x94d049bb133111ebULL;
+            key ^= key >> 31;
+            return key;
+        }
+
+        void rehash(size_t capacity)
+        {
+            std::vector<Slot> old;
+            old.swap(slots);
+            slots.assign(capacity, Slot{0, V()});
+            mask = capacity - 1;
+            for (const auto& slot : old) {
+                if (slot.key) place(slot.key, slot.value);
+            }
+        }
+
+        void place(uint64_t key, const V& value)
+        {
+            size_t i = mix(key) & mask;
+            while (slots[i].key) i = (i + 1) & mask;
+            slots[i] = Slot{key, value};
+        }
+
+        // Keep the load factor at or below 0.7
+        void growFor(size_t needed)
+        {
+            size_t capacity = slots.empty() ? 16 : slots.size();
+            while (needed * 10 > capacity * 7) capacity *= 2;
+            if (capacity != slots.size()) rehash(capacity);
+        }
+
+        size_t probe(uint64_t key) const
+        {
+            size_t i = mix(key) & mask;
+            while (slots[i].key && slots[i].key != key) i = (i + 1) & mask;
+            return i;
+        }
+
+    public:
+        AccountIndex() : count(0), mask(0) {}
+
+        size_t size() const { return count + fallback.size(); }
+
+        void reserve(size_t n) { growFor(n); }
+
+        void clear()
+        {
+            slots.clear();
+            count = 0;
+            mask = 0;
+            fallback.clear();
+        }
+
+        // Pointer to the stored value, nullptr when absent
+        V* find(const std::string& accNum)
+        {
+            uint64_t key;
+            if (!parseAccountKey(accNum, key)) {
+                auto it = fallback.find(accNum);
+                return it != fallback.end() ? &it->second : nullptr;
+            }
+            if (slots.empty()) return nullptr;
+            size_t i = probe(key);
+            return slots[i].key ? &slots[i].value : nullptr;
+        }
+
+        // Insert when absent; returns false (and changes nothing) when present
+        bool insert(const std::string& accNum, const V& value)
+        {
+            uint64_t key;
+            if (!parseAccountKey(accNum, key)) {
+                return fallback.emplace(accNum, value).second;
+            }
+            growFor(count + 1);
+            size_t i = probe(key);
+            if (slots[i].key) return false;
+            slots[i] = Slot{key, value};
+            count++;
+            return true;
+        }
+
+        void insertOrAssign(const std::string& accNum, const V& value)
+        {
+            if (V* existing = find(accNum)) {
+                *existing = value;
+            } else {
+                insert(accNum, value);
+            }
+        }
+
+        // Remove with backward-shift deletion so no tombstones build up
+        bool erase(const std::string& accNum)
+        {
+            uint64_t key;
+            if (!parseAccountKey(accNum, key)) {
+                return fallback.erase(accNum) > 0;
+            }
+            if (slots.empty()) return false;
+            size_t hole = probe(key);
+            if (!slots[hole].key) return false;
+
+            size_t i = hole;
+            while (true) {
+                i = (i + 1) & mask;
+                if (!slots[i].key) break;
+                size_t home = mix(slots[i].key) & mask;
+                // Move the entry back if the hole lies on its probe path
+                if (((i - home) & mask) >= ((i - hole) & mask)) {
+                    slots[hole] = slots[i];
+                    hole = i;
+                }
+            }
+            slots[hole] = Slot{0, V()};
+            count--;
+            return true;
+        }
+    };
+}
+
+#endif // ACCOUNT_INDEX_H
@@ -0,0 +1,321 @@
+#ifndef ACCOUNT_STORE_H
+#define ACCOUNT_STORE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+#include "account_index.h"
+#include "balance_cell.h"
+#include "customer_store.h"
+
+// ----------------------------Contiguous account storage--------------------------------
+//
+// Saving and Business accounts live by value in one typed slab each instead of as
+// separate heap objects behind a vector of base pointers. A slab is a list of
+// fixed-size chunks: chunks never move, so an account's address and its handle stay
+// valid while the store grows, and a full scan walks memory chunk by chunk. Scans hand
+// the callback the concrete account type, so calls inside it are resolved statically
+// (both account classes are final) instead of through the vtable.
+//
+// Balance-only passes (totals, zakat, interest) do not need the account objects at
+// all: AccountStore also keeps the hot fields of every account in column arrays
+// indexed by row, and forEachHot()/forEachHotChunk() walk only those.
+
+namespace Banking
+{
+    template<typename B> class BankAccount;
+    template<typename B> class SavingAccount;
+    template<typename B> class BusinessAccount;
+
+    template<typename T, size_t ChunkSize = 1024>
+    class Slab
+    {
+    private:
+        struct Chunk
+        {
+            alignas(T) unsigned char storage[sizeof(T) * ChunkSize];
+            bool live[ChunkSize] = {};
+
+            T* at(size_t i) { return reinterpret_cast<T*>(storage + i * sizeof(T)); }
+        };
+
+        std::vector<std::unique_ptr<Chunk>> chunks;
+        std::vector<uint32_t> freeSlots;    // erased slots, reused before growing
+        uint32_t used;                      // slots handed out so far (live or free)
+        size_t liveCount;
+
+    public:
+        Slab() : used(0), liveCount(0) {}
+        ~Slab() { clear(); }
+
+        Slab(const Slab&) = delete;
+        Slab& operator=(const Slab&) = delete;
+
+        // Construct a T in place and return its slot
+        template<typename... Args>
+        uint32_t emplace(Args&&... args)
+        {
+            uint32_t slot;
+            if (!freeSlots.empty()) {
+                slot = freeSlots.back();
+                freeSlots.pop_back();
+            } else {
+                if (used % ChunkSize == 0) chunks.emplace_back(new Chunk());
+                slot = used++;
+            }
+            Chunk& chunk = *chunks[slot / ChunkSize];
+            new (chunk.at(slot % ChunkSize)) T(std::forward<Args>(args)...);
+            chunk.live[slot % ChunkSize] = true;
+            liveCount++;
+            return slot;
+        }
+
+        T& at(uint32_t slot) { return *chunks[slot / ChunkSize]->at(slot % ChunkSize); }
+
+        bool isLive(uint32_t slot) const
+        {
+            return slot < used && chunks[slot / ChunkSize]->live[slot % ChunkSize];
+        }
+
+        void erase(uint32_t slot)
+        {
+            Chunk& chunk = *chunks[slot / ChunkSize];
+            chunk.at(slot % ChunkSize)->~T();
+            chunk.live[slot % ChunkSize] = false;
+            freeSlots.push_back(slot);
+            liveCount--;
+        }
+
+        // Visit every live object in slot order
+        template<typename F>
+        void forEach(F&& fn)
+        {
+            for (uint32_t c = 0; c < chunks.size(); c++) {
+                Chunk& chunk = *chunks[c];
+                uint32_t end = std::min<uint32_t>(ChunkSize, used - c * ChunkSize);
+                for (uint32_t i = 0; i < end; i++) {
+                    if (chunk.live[i]) fn(*chunk.at(i));
+                }
+            }
+        }
+
+        size_t size() const { return liveCount; }
+
+        void clear()
+        {
+            forEach([](T& obj) { obj.~T(); });
+            chunks.clear();
+            freeSlots.clear();
+            used = 0;
+            liveCount = 0;
+        }
+    };
+
+    // Stable reference to an account object in a slab: the top bit selects the slab
+    struct AccountHandle
+    {
+        static const uint32_t businessBit = 0x80000000u;
+        uint32_t value = 0;
+
+        bool isBusiness() const { return (value & businessBit) != 0; }
+        uint32_t slot() const { return value & ~businessBit; }
+    };
+
+    // Row returned when an account could not be stored
+    const uint32_t noAccountRow = 0xffffffffu;
+
+    enum HotType : uint8_t { HotSaving = 0, HotBusiness = 1 };   // same codes as SnapshotRecord::type
+    enum HotFlag : uint8_t
+    {
+        HotLive = 1,
+        HotDirty = 2        // changed since the last delta batch (set by Bank)
+    };
+
+    // One chunk of hot rows: each column is a dense array, so a pass over balances
+    // reads 8 bytes per account and nothing else. Balances and flags are atomic so
+    // deposits and dirty marking can run without locks.
+    template<typename B, size_t ChunkSize>
+    struct HotChunk
+    {
+        uint64_t ids[ChunkSize];            // parseAccountKey() key, 0 for other numbers
+        BalanceCell<B> balances[ChunkSize];
+        uint8_t types[ChunkSize];
+        std::atomic<uint8_t> flags[ChunkSize];
+        int32_t accrualDays[ChunkSize];     // last day interest was credited, 0 for never
+        AccountHandle handles[ChunkSize];   // account object of the row
+    };
+
+    // Columns of one chunk as handed to forEachHotChunk(); rows without HotLive are holes
+    template<typename B>
+    struct HotSpan
+    {
+        uint32_t firstRow;
+        uint32_t count;
+        const uint64_t* ids;
+        BalanceCell<B>* balances;
+        const uint8_t* types;
+        std::atomic<uint8_t>* flags;
+        int32_t* accrualDays;
+    };
+
+    // Accounts are addressed by row. Id, balance, type and flags of a row live in dense
+    // hot columns; the account object in its slab points its balance at the row's cell,
+    // and its PersonalInfo is kept in a CustomerStore under the same row.
+    template<typename B>
+    class AccountStore
+    {
+    private:
+        static const size_t rowChunkSize = 1024;
+        using Chunk = HotChunk<B, rowChunkSize>;
+
+        Slab<SavingAccount<B>> savings;
+        Slab<BusinessAccount<B>> business;
+        std::vector<std::unique_ptr<Chunk>> rows;
+        std::vector<uint32_t> freeRows;
+        uint32_t usedRows;
+        CustomerStore customerStore;
+
+        uint32_t allocRow()
+        {
+            if (!freeRows.empty()) {
+                uint32_t row = freeRows.back();
+                freeRows.pop_back();
+                return row;
+            }
+            if (usedRows % rowChunkSize == 0) rows.emplace_back(new Chunk());
+            return usedRows++;
+        }
+
+        Chunk& chunkOf(uint32_t row) { return *rows[row / rowChunkSize]; }
+
+        // Give a freshly built account object a row and move its hot and cold data there
+        uint32_t attach(BankAccount<B>& acc, AccountHandle handle, uint8_t type)
+        {
+            uint32_t row = allocRow();
+            Chunk& chunk = chunkOf(row);
+            size_t i = row % rowChunkSize;
+            uint64_t key;
+            chunk.ids[i] = parseAccountKey(acc.getAccountNumber(), key) ? key : 0;
+            chunk.types[i] = type;
+            chunk.flags[i] = HotLive;
+            chunk.accrualDays[i] = 0;
+            chunk.handles[i] = handle;
+            acc.attach(&chunk.balances[i], &customerStore, row);
+            return row;
+        }
+
+    public:
+        AccountStore() : usedRows(0) {}
+
+        AccountStore(const AccountStore&) = delete;
+        AccountStore& operator=(const AccountStore&) = delete;
+
+        template<typename... Args>
+        uint32_t emplaceSaving(Args&&... args)
+        {
+            AccountHandle h;
+            h.value = savings.emplace(std::forward<Args>(args)...);
+            return attach(savings.at(h.slot()), h, HotSaving);
+        }
+
+        template<typename... Args>
+        uint32_t emplaceBusiness(Args&&... args)
+        {
+            AccountHandle h;
+            h.value = business.emplace(std::forward<Args>(args)...) | AccountHandle::businessBit;
+            return attach(business.at(h.slot()), h, HotBusiness);
+        }
+
+        BankAccount<B>* get(uint32_t row)
+        {
+            AccountHandle h = chunkOf(row).handles[row % rowChunkSize];
+            if (h.isBusiness()) return &business.at(h.slot());
+            return &savings.at(h.slot());
+        }
+
+        BalanceCell<B>& balanceAt(uint32_t row) { return chunkOf(row).balances[row % rowChunkSize]; }
+        std::atomic<uint8_t>& flagsAt(uint32_t row) { return chunkOf(row).flags[row % rowChunkSize]; }
+        uint8_t typeAt(uint32_t row) { return chunkOf(row).types[row % rowChunkSize]; }
+        int32_t& accrualDayAt(uint32_t row) { return chunkOf(row).accrualDays[row % rowChunkSize]; }
+
+        void erase(uint32_t row)
+        {
+            Chunk& chunk = chunkOf(row);
+            size_t i = row % rowChunkSize;
+            AccountHandle h = chunk.handles[i];
+            if (h.isBusiness()) business.erase(h.slot());
+            else savings.erase(h.slot());
+            chunk.flags[i] = 0;
+            chunk.ids[i] = 0;
+            chunk.accrualDays[i] = 0;
+            chunk.balances[i].store(B());
+            customerStore.erase(row);
+            freeRows.push_back(row);
+        }
+
+        // Visit every account with its concrete type (generic lambdas get
+        // SavingAccount<B>& and BusinessAccount<B>&)
+        template<typename F>
+        void forEach(F&& fn)
+        {
+            savings.forEach(fn);
+            business.forEach(fn);
+        }
+
+        template<typename F>
+        void forEachSaving(F&& fn) { savings.forEach(std::forward<F>(fn)); }
+
+        template<typename F>
+        void forEachBusiness(F&& fn) { business.forEach(std::forward<F>(fn)); }
+
+        // Visit the hot columns chunk by chunk; nothing but the columns is touched
+        template<typename F>
+        void forEachHotChunk(F&& fn)
+        {
+            for (uint32_t c = 0; c < rows.size(); c++) {
+                Chunk& chunk = *rows[c];
+                HotSpan<B> span;
+                span.firstRow = static_cast<uint32_t>(c * rowChunkSize);
+                span.count = std::min<uint32_t>(rowChunkSize, usedRows - span.firstRow);
+                span.ids = chunk.ids;
+                span.balances = chunk.balances;
+                span.types = chunk.types;
+                span.flags = chunk.flags;
+                span.accrualDays = chunk.accrualDays;
+                fn(span);
+            }
+        }
+
+        // Visit every live row as fn(row, BalanceCell<B>&, type) without touching account objects
+        template<typename F>
+        void forEachHot(F&& fn)
+        {
+            forEachHotChunk([&fn](HotSpan<B>& span) {
+                for (uint32_t i = 0; i < span.count; i++) {
+                    if (span.flags[i] & HotLive) fn(span.firstRow + i, span.balances[i], span.types[i]);
+                }
+            });
+        }
+
+        CustomerStore& customers() { return customerStore; }
+
+        size_t size() const { return savings.size() + business.size(); }
+
+        void clear()
+        {
+            savings.clear();
+            business.clear();
+            rows.clear();
+            freeRows.clear();
+            usedRows = 0;
+            customerStore.clear();
+        }
+    };
+}
+
+#endif // ACCOUNT_STORE_H
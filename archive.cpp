@@ -0,0 +1,420 @@
+// ----------------------------Columnar segment archive implementation--------------------------------
+
+#include "bank.h"
+#include "archive.h"
+#include "segment.h"
+#include <cerrno>
+#include <cstring>
+#include <string_view>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Banking;
+using namespace Banking::Exceptions;
+
+namespace
+{
+    const char archiveMagic[8] = {'M', 'D', 'B', 'A', 'R', 'C', 'H', '\0'};
+
+    uint32_t headerChecksum(const ArchiveHeader& header)
+    {
+        return TransactionJournal::checksum(reinterpret_cast<const char*>(&header),
+                                            offsetof(ArchiveHeader, checksum));
+    }
+
+    bool readAt(int fd, void* out, size_t length, uint64_t offset)
+    {
+        char* p = static_cast<char*>(out);
+        while (length > 0) {
+            ssize_t n = pread(fd, p, length, static_cast<off_t>(offset));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            p += n;
+            offset += static_cast<uint64_t>(n);
+            length -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    void writeAll(int fd, const char* data, size_t length, const string& path)
+    {
+        while (length > 0) {
+            ssize_t n = ::write(fd, data, length);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw FileException("Write to " + path + " failed: " + strerror(errno));
+            }
+            data += n;
+            length -= static_cast<size_t>(n);
+        }
+    }
+
+    void putVarint(string& out, uint64_t value)
+    {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    uint64_t zigzag(int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    int64_t unzigzag(uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    // Strings numbered in the order they are first seen, stored sorted and front-coded
+    class Dictionary
+    {
+    private:
+        unordered_map<string, uint32_t> ids;
+        vector<const string*> byId;
+
+    public:
+        uint32_t idOf(const string& value)
+        {
+            auto slot = ids.try_emplace(value, static_cast<uint32_t>(byId.size()));
+            if (slot.second) byId.push_back(&slot.first->first);
+            return slot.first->second;
+        }
+
+        // Count, then every name in order as (bytes shared with the name before, length
+        // of the rest, the rest). Returns the stored position of every id.
+        vector<uint32_t> encode(string& out) const
+        {
+            vector<uint32_t> order(byId.size());
+            for (uint32_t id = 0; id < order.size(); id++) order[id] = id;
+            sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return *byId[a] < *byId[b]; });
+            vector<uint32_t> position(byId.size());
+            putVarint(out, order.size());
+            const string* previous = nullptr;
+            for (uint32_t p = 0; p < order.size(); p++) {
+                const string& name = *byId[order[p]];
+                size_t shared = 0;
+                if (previous) {
+                    size_t limit = min(previous->size(), name.size());
+                    while (shared < limit && (*previous)[shared] == name[shared]) shared++;
+                }
+                putVarint(out, shared);
+                putVarint(out, name.size() - shared);
+                out.append(name, shared, string::npos);
+                position[order[p]] = p;
+                previous = &name;
+            }
+            return position;
+        }
+    };
+
+    // Walks one column; anything that runs past its end is damage the CRC did not catch
+    class ColumnReader
+    {
+    private:
+        const char* p;
+        const char* end;
+        const string& path;
+
+    public:
+        ColumnReader(const string& column, const string& archivePath)
+            : p(column.data()), end(column.data() + column.size()), path(archivePath) {}
+
+        uint64_t varint()
+        {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                if (p == end) break;
+                uint8_t byte = static_cast<uint8_t>(*p++);
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) return value;
+            }
+            throw FileException("Archive column is damaged: " + path);
+        }
+
+        string_view bytes(uint64_t length)
+        {
+            if (static_cast<uint64_t>(end - p) < length) {
+                throw FileException("Archive column is damaged: " + path);
+            }
+            string_view view(p, static_cast<size_t>(length));
+            p += length;
+            return view;
+        }
+    };
+
+    vector<string> decodeDictionary(const string& column, const string& path)
+    {
+        ColumnReader reader(column, path);
+        vector<string> names(reader.varint());
+        for (size_t i = 0; i < names.size(); i++) {
+            uint64_t shared = reader.varint();
+            if (shared > 0 && (i == 0 || shared > names[i - 1].size())) {
+                throw FileException("Archive column is damaged: " + path);
+            }
+            if (shared > 0) names[i].assign(names[i - 1], 0, static_cast<size_t>(shared));
+            names[i].append(reader.bytes(reader.varint()));
+        }
+        return names;
+    }
+
+    vector<uint32_t> decodeIds(const string& column, uint64_t count, size_t dictionarySize, const string& path)
+    {
+        ColumnReader reader(column, path);
+        vector<uint32_t> ids(count);
+        for (auto& id : ids) {
+            uint64_t value = reader.varint();
+            if (value >= dictionarySize) throw FileException("Archive column is damaged: " + path);
+            id = static_cast<uint32_t>(value);
+        }
+        return ids;
+    }
+}
+
+SegmentArchive::SegmentArchive(const string& archivePath, uint64_t journalEnd)
+    : path(archivePath), fd(-1), endOffset(0)
+{
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw FileException("Failed to open segment archive: " + path);
+    }
+    struct stat st;
+    uint64_t fileSize = fstat(fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+
+    // Headers are checked all the way; the columns only of the last block, the one a
+    // crash can have cut short
+    ArchiveHeader header;
+    while (endOffset + sizeof(header) <= fileSize && readAt(fd, &header, sizeof(header), endOffset)) {
+        bool valid = memcmp(header.magic, archiveMagic, sizeof(archiveMagic)) == 0
+            && header.version == archiveVersion
+            && header.columnCount == ArchiveColumnCount
+            && header.checksum == headerChecksum(header)
+            && header.journalEnd <= journalEnd
+            && (directory.empty() || header.journalStart >= directory.back().second.journalEnd);
+        uint64_t blockSize = sizeof(header);
+        for (const ArchiveColumnInfo& column : header.columns) {
+            valid = valid && column.offset == blockSize && column.length <= fileSize - endOffset - blockSize;
+            if (!valid) break;
+            blockSize += column.length;
+        }
+        if (!valid) break;
+        directory.emplace_back(endOffset, header);
+        endOffset += blockSize;
+    }
+    if (!directory.empty()) {
+        try {
+            for (int c = 0; c < ArchiveColumnCount; c++) {
+                readColumn(directory.size() - 1, static_cast<ArchiveColumn>(c));
+            }
+        } catch (const FileException&) {
+            endOffset = directory.back().first;
+            directory.pop_back();
+        }
+    }
+    if (fileSize > endOffset && ftruncate(fd, static_cast<off_t>(endOffset)) != 0) {
+        throw FileException("Failed to truncate segment archive: " + path);
+    }
+}
+
+SegmentArchive::~SegmentArchive()
+{
+    if (fd >= 0) ::close(fd);
+}
+
+bool SegmentArchive::append(const SegmentFooter& segment, const MappedSegment& records)
+{
+    string columns[ArchiveColumnCount];
+    Dictionary accounts, labels;
+    vector<uint32_t> from, to, statuses, types;
+    int64_t previousDate = 0;
+    uint64_t previousOffset = 0;
+    bool lossless = true;
+    records.forEach([&](const JournalRecord& r, uint64_t offset) {
+        Money amount = Money::fromDouble(r.amount);
+        if (amount.toDouble() != r.amount) {
+            lossless = false;
+            return false;
+        }
+        putVarint(columns[ArchiveDates], zigzag(r.date - previousDate));
+        putVarint(columns[ArchiveAmounts], zigzag(amount.minorUnits()));
+        from.push_back(accounts.idOf(r.fromAccount));
+        to.push_back(accounts.idOf(r.toAccount));
+        statuses.push_back(labels.idOf(r.status));
+        types.push_back(labels.idOf(r.transactionType));
+        if (from.size() > 1) {
+            putVarint(columns[ArchiveLengths], offset - previousOffset - TransactionJournal::frameHeaderSize);
+        }
+        previousDate = r.date;
+        previousOffset = offset;
+        return true;
+    });
+    // A segment that does not read back whole is left to the journal as well
+    uint64_t count = from.size();
+    if (!lossless || count != segment.count || count == 0) return false;
+    putVarint(columns[ArchiveLengths], segment.endOffset - previousOffset - TransactionJournal::frameHeaderSize);
+
+    // Ids are written once the dictionaries are sorted
+    vector<uint32_t> accountAt = accounts.encode(columns[ArchiveAccountNames]);
+    vector<uint32_t> labelAt = labels.encode(columns[ArchiveLabels]);
+    for (size_t r = 0; r < count; r++) {
+        putVarint(columns[ArchiveFromAccounts], accountAt[from[r]]);
+        putVarint(columns[ArchiveToAccounts], accountAt[to[r]]);
+        putVarint(columns[ArchiveTypes], labelAt[types[r]]);
+    }
+    for (size_t r = 0; r < count;) {
+        size_t run = 1;
+        while (r + run < count && statuses[r + run] == statuses[r]) run++;
+        putVarint(columns[ArchiveStatuses], labelAt[statuses[r]]);
+        putVarint(columns[ArchiveStatuses], run);
+        r += run;
+    }
+
+    ArchiveHeader header = {};
+    memcpy(header.magic, archiveMagic, sizeof(archiveMagic));
+    header.version = archiveVersion;
+    header.columnCount = ArchiveColumnCount;
+    header.journalStart = segment.startOffset;
+    header.journalEnd = segment.endOffset;
+    header.count = count;
+    header.minDate = segment.minDate;
+    header.maxDate = segment.maxDate;
+    uint64_t offset = sizeof(header);
+    for (int c = 0; c < ArchiveColumnCount; c++) {
+        header.columns[c].offset = offset;
+        header.columns[c].length = columns[c].size();
+        header.columns[c].checksum = TransactionJournal::checksum(columns[c].data(), columns[c].size());
+        offset += columns[c].size();
+    }
+    header.checksum = headerChecksum(header);
+
+    string buffer(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const string& column : columns) buffer.append(column);
+    writeAll(fd, buffer.data(), buffer.size(), path);
+
+    lock_guard<mutex> lock(directoryMutex);
+    directory.emplace_back(endOffset, header);
+    endOffset += buffer.size();
+    return true;
+}
+
+size_t SegmentArchive::size() const
+{
+    lock_guard<mutex> lock(directoryMutex);
+    return directory.size();
+}
+
+uint64_t SegmentArchive::bytes() const
+{
+    lock_guard<mutex> lock(directoryMutex);
+    return endOffset;
+}
+
+ArchiveHeader SegmentArchive::at(size_t i) const
+{
+    lock_guard<mutex> lock(directoryMutex);
+    return directory.at(i).second;
+}
+
+long SegmentArchive::find(uint64_t journalStart) const
+{
+    lock_guard<mutex> lock(directoryMutex);
+    auto it = lower_bound(directory.begin(), directory.end(), journalStart,
+                          [](const pair<uint64_t, ArchiveHeader>& block, uint64_t start) {
+                              return block.second.journalStart < start;
+                          });
+    if (it == directory.end() || it->second.journalStart != journalStart) return -1;
+    return static_cast<long>(it - directory.begin());
+}
+
+string SegmentArchive::readColumn(size_t i, ArchiveColumn column) const
+{
+    uint64_t blockOffset;
+    ArchiveColumnInfo info;
+    {
+        lock_guard<mutex> lock(directoryMutex);
+        blockOffset = directory.at(i).first;
+        info = directory.at(i).second.columns[column];
+    }
+    string bytes(info.length, '\0');
+    if (!readAt(fd, &bytes[0], bytes.size(), blockOffset + info.offset)
+        || TransactionJournal::checksum(bytes.data(), bytes.size()) != info.checksum) {
+        throw FileException("Archive column is damaged: " + path);
+    }
+    return bytes;
+}
+
+vector<int64_t> SegmentArchive::dates(size_t i) const
+{
+    uint64_t count = at(i).count;
+    string column = readColumn(i, ArchiveDates);
+    ColumnReader reader(column, path);
+    vector<int64_t> values(count);
+    int64_t date = 0;
+    for (auto& value : values) {
+        date += unzigzag(reader.varint());
+        value = date;
+    }
+    return values;
+}
+
+vector<int64_t> SegmentArchive::amounts(size_t i) const
+{
+    uint64_t count = at(i).count;
+    string column = readColumn(i, ArchiveAmounts);
+    ColumnReader reader(column, path);
+    vector<int64_t> values(count);
+    for (auto& value : values) value = unzigzag(reader.varint());
+    return values;
+}
+
+bool SegmentArchive::forEach(size_t i, const function<bool(const JournalRecord&, uint64_t)>& fn) const
+{
+    ArchiveHeader header = at(i);
+    vector<int64_t> dateColumn = dates(i);
+    vector<int64_t> amountColumn = amounts(i);
+    vector<string> accountNames = decodeDictionary(readColumn(i, ArchiveAccountNames), path);
+    vector<string> labelNames = decodeDictionary(readColumn(i, ArchiveLabels), path);
+    vector<uint32_t> from = decodeIds(readColumn(i, ArchiveFromAccounts), header.count, accountNames.size(), path);
+    vector<uint32_t> to = decodeIds(readColumn(i, ArchiveToAccounts), header.count, accountNames.size(), path);
+    vector<uint32_t> types = decodeIds(readColumn(i, ArchiveTypes), header.count, labelNames.size(), path);
+    string statusColumn = readColumn(i, ArchiveStatuses);
+    ColumnReader statuses(statusColumn, path);
+    string lengthColumn = readColumn(i, ArchiveLengths);
+    ColumnReader lengths(lengthColumn, path);
+
+    JournalRecord record;
+    uint64_t offset = header.journalStart;
+    uint64_t runLength = 0;
+    for (uint64_t r = 0; r < header.count; r++) {
+        if (runLength == 0) {
+            uint64_t status = statuses.varint();
+            runLength = statuses.varint();
+            if (status >= labelNames.size() || runLength == 0) {
+                throw FileException("Archive column is damaged: " + path);
+            }
+            record.status = labelNames[status];
+        }
+        runLength--;
+        record.date = dateColumn[r];
+        record.amount = Money::fromMinor(amountColumn[r]).toDouble();
+        record.fromAccount = accountNames[from[r]];
+        record.toAccount = accountNames[to[r]];
+        record.transactionType = labelNames[types[r]];
+        if (!fn(record, offset)) return false;
+        offset += TransactionJournal::frameHeaderSize + lengths.varint();
+    }
+    return true;
+}
+
+string SegmentArchive::pathFor(const string& journalPath)
+{
+    const string suffix = ".journal";
+    if (journalPath.size() > suffix.size() &&
+        journalPath.compare(journalPath.size() - suffix.size(), suffix.size(), suffix) == 0) {
+        return journalPath.substr(0, journalPath.size() - suffix.size()) + ".archive";
+    }
+    return journalPath + ".archive";
+}
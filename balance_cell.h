@@ -0,0 +1,116 @@
+#ifndef BALANCE_CELL_H
+#define BALANCE_CELL_H
+
+#include <atomic>
+#include <stdexcept>
+#include "money.h"
+
+// ----------------------------Atomic balance cell--------------------------------
+//
+// Every balance lives in a BalanceCell, and every change to it is a single atomic
+// read-modify-write. A deposit therefore needs no lock at all, a withdrawal is a
+// compare-and-swap loop that refuses to take the balance below zero, and both stay
+// correct next to stripe-locked operations (transfers, zakat) on the same account.
+// Money cells are a plain int64 of minor units, so a deposit is one fetch_add; float
+// and double cells fall back to a CAS loop.
+
+namespace Banking
+{
+    template<typename B>
+    class BalanceCell
+    {
+    private:
+        std::atomic<B> value;
+
+    public:
+        BalanceCell() : value(B()) {}
+        explicit BalanceCell(B initial) : value(initial) {}
+
+        BalanceCell(const BalanceCell&) = delete;
+        BalanceCell& operator=(const BalanceCell&) = delete;
+
+        B load() const { return value.load(); }
+        void store(B amount) { value.store(amount); }
+
+        // Add (or with a negative amount, subtract) and return the new balance
+        B add(B amount)
+        {
+            B current = value.load(std::memory_order_relaxed);
+            while (!value.compare_exchange_weak(current, current + amount)) {}
+            return current + amount;
+        }
+
+        // Subtract amount unless that would leave less than zero; false when refused
+        bool tryWithdraw(B amount)
+        {
+            B current = value.load(std::memory_order_relaxed);
+            do {
+                if (amount > current) return false;
+            } while (!value.compare_exchange_weak(current, current - amount));
+            return true;
+        }
+
+        // Replace the balance with desired if it still is expected; otherwise expected
+        // gets the current balance. For changes that depend on the balance itself.
+        bool compareExchange(B& expected, B desired) { return value.compare_exchange_weak(expected, desired); }
+
+        operator B() const { return load(); }
+        BalanceCell& operator=(B amount) { store(amount); return *this; }
+        BalanceCell& operator+=(B amount) { add(amount); return *this; }
+        BalanceCell& operator-=(B amount) { add(-amount); return *this; }
+    };
+
+    template<>
+    class BalanceCell<Money>
+    {
+    private:
+        std::atomic<int64_t> minor;
+
+    public:
+        BalanceCell() : minor(0) {}
+        explicit BalanceCell(Money initial) : minor(initial.minorUnits()) {}
+
+        BalanceCell(const BalanceCell&) = delete;
+        BalanceCell& operator=(const BalanceCell&) = delete;
+
+        Money load() const { return Money::fromMinor(minor.load()); }
+        void store(Money amount) { minor.store(amount.minorUnits()); }
+
+        // One fetch_add; an overflowing add is undone and reported like Money's own
+        Money add(Money amount)
+        {
+            int64_t delta = amount.minorUnits();
+            int64_t before = minor.fetch_add(delta);
+            if (delta > 0 ? before > INT64_MAX - delta : before < INT64_MIN - delta) {
+                minor.fetch_sub(delta);
+                throw std::overflow_error("Money overflow");
+            }
+            return Money::fromMinor(before + delta);
+        }
+
+        bool tryWithdraw(Money amount)
+        {
+            int64_t delta = amount.minorUnits();
+            int64_t current = minor.load(std::memory_order_relaxed);
+            do {
+                if (delta > current) return false;
+            } while (!minor.compare_exchange_weak(current, current - delta));
+            return true;
+        }
+
+        bool compareExchange(Money& expected, Money desired)
+        {
+            int64_t current = expected.minorUnits();
+            if (minor.compare_exchange_weak(current, desired.minorUnits())) return true;
+            expected = Money::fromMinor(current);
+            return false;
+        }
+
+        operator Money() const { return load(); }
+        BalanceCell& operator=(Money amount) { store(amount); return *this; }
+        BalanceCell& operator+=(Money amount) { add(amount); return *this; }
+        BalanceCell& operator-=(Money amount) { add(-amount); return *this; }
+    };
+}
+
+#endif // BALANCE_CELL_H
@@ -12,6 +12,8 @@ using namespace Banking::Exceptions;
 // Initialize static member
 template<typename B>
 Bank<B>* Bank<B>::instance = nullptr;
+template<typename B>
+once_flag Bank<B>::instanceFlag;
 
 
 // ========================= User class implementation ========================
@@ -96,8 +98,8 @@ void BankMember::paySalary(Bank<B>* bank) {
     if (!bank) {
         throw TransactionException("Bank instance is null");// Check if bank instance is null using exception handling
     }
-    if (BankAccount<B>* account = bank->findAccount(accountNumber)) {
-        account->updateBalance(salary);
+    if (bank->findAccount(accountNumber)) {
+        bank->deposit(accountNumber, AmountTraits<B>::fromDouble(salary), "Salary");
         cout << "Paid salary of $" << salary << " to " << name << endl;
     } else {
         throw AccountException("Account not found for salary payment");// Check if account exists using exception handling
@@ -108,27 +110,36 @@ void BankMember::paySalary(Bank<B>* bank) {
 // ========================= BankAccount<B> class implementation ========================
 template<typename B>
 BankAccount<B>::BankAccount()
+    : balance(&ownBalance), ownBalance(), infoStore(nullptr), infoRow(0), ownInfo(new PersonalInfo())
 {  
-    balance = B();
     accountNumber = "";
-    customerInfo.name = "";
-    customerInfo.openingDate = time(nullptr);
+    ownInfo->name = "";
+    ownInfo->openingDate = time(nullptr);
 }
 template<typename B>
 BankAccount<B>::BankAccount(string accountNum, B balance, PersonalInfo info) 
+    : balance(&ownBalance), ownBalance(balance), infoStore(nullptr), infoRow(0), ownInfo(new PersonalInfo(info))
 {
     accountNumber = accountNum;
-    this->balance = balance;
-    this->customerInfo = info; 
-    customerInfo.openingDate = time(nullptr);
+    ownInfo->openingDate = time(nullptr);
 }
 template<typename B>
 //----- Copy constructor (deep copy)------
 BankAccount<B>::BankAccount(const BankAccount& other)
+    : balance(&ownBalance), ownBalance(other.balance->load()), infoStore(nullptr), infoRow(0),
+      ownInfo(new PersonalInfo(other.getCustomerInfo()))
 {
-    balance = other.balance;
     accountNumber = other.accountNumber;
-    customerInfo = other.customerInfo;
+}
+template<typename B>
+void BankAccount<B>::attach(BalanceCell<B>* balanceCell, CustomerStore* customers, uint32_t row)
+{
+    balanceCell->store(balance->load());
+    balance = balanceCell;
+    customers->set(row, *ownInfo);
+    ownInfo.reset();
+    infoStore = customers;
+    infoRow = row;
 }
 template<typename B>
 void BankAccount<B>::setAccountNumber(const string& accountNum)
@@ -143,13 +154,14 @@ template<typename B>
 // Setters functions:
 void BankAccount<B>::setBalance(B balance)
 {
-     this->balance = balance;
+     this->balance->store(balance);
 }
 template<typename B>
 // Setters functions:
 void BankAccount<B>::setCustomerInfo(const PersonalInfo& info)
 {
-    customerInfo = info;
+    if (infoStore) infoStore->set(infoRow, info);
+    else *ownInfo = info;
 }
 template<typename B>
 // Getters functions:
@@ -160,27 +172,27 @@ string BankAccount<B>::getAccountNumber() const
 template<typename B>
 B BankAccount<B>::getBalance() const
 {
-    return balance;
+    return balance->load();
 }
 template<typename B>
 PersonalInfo BankAccount<B>::getCustomerInfo() const
 {
-    return customerInfo;
+    return infoStore ? infoStore->get(infoRow) : *ownInfo;
 }
 template<typename B>
 // Member virtaul functions:
  void BankAccount<B>::displayAccountInfo() const
 {
-    cout << customerInfo;
+    cout << getCustomerInfo();
     cout << "Account Number: " << accountNumber << endl;
-    cout << "Current Balance: $" << balance << endl;
+    cout << "Current Balance: $" << balance->load() << endl;
 }
 template<typename B>
  B BankAccount<B>::updateBalance(B amount)
 {
-    balance += amount;
-    cout << "Balance updated: $" << balance << endl;
-    return balance;
+    B newBalance = balance->add(amount);     // atomic, needs no lock
+    cout << "Balance updated: $" << newBalance << endl;
+    return newBalance;
 }
 template<typename B>
 B BankAccount<B>::withdraw(B amount)
@@ -188,10 +200,9 @@ B BankAccount<B>::withdraw(B amount)
     if (amount <= 0) {
         throw TransactionException("Withdrawal amount must be positive");
     }
-    if (amount > balance) {
+    if (!balance->tryWithdraw(amount)) {      // compare-and-swap, never goes negative
         throw TransactionException("Insufficient balance");
     }
-    balance -= amount;
     cout << "Withdrawal successful!" << endl;
     return amount;
 }
@@ -205,9 +216,6 @@ SavingAccount<B>::SavingAccount()
     zakat = 0;
     yearSaved = 0;
     canWithdraw = true;
-    this->balance = B();  
-    this->accountNumber = "";
-    this->customerInfo.name = "";
 }
 
 template<typename B>
@@ -236,7 +244,7 @@ template<typename B>
 // Inline function
 inline bool SavingAccount<B>::isZakatApplicable() const
 {
-    return this->balance >= 20000;
+    return this->balance->load() >= 20000;
 }
 
 template<typename B>
@@ -254,14 +262,19 @@ template<typename B>
 // Calculate Zakat function
 void SavingAccount<B>::calculateZakat()
 {
-    if (this->balance >= 20000) {  // Nisab amount
-        zakat = this->balance * 0.025;  // 2.5%
-        this->balance -= zakat;
-        cout << "Zakat of $" << zakat << " deducted from account "
-             << this->accountNumber << endl;
-    } else {
-        cout << "Balance below Nisab, no Zakat due\n";
+    // Lock-free withdrawals can change the balance at any moment, so the zakat is taken
+    // with a compare-and-swap against the balance it was computed from
+    B current = this->balance->load();
+    while (current >= 20000) {  // Nisab amount
+        B due = AmountTraits<B>::mulDiv(current, 25, 1000, Rounding::HalfEven);  // 2.5%
+        if (this->balance->compareExchange(current, current - due)) {
+            zakat = due;
+            cout << "Zakat of $" << zakat << " deducted from account "
+                 << this->accountNumber << endl;
+            return;
+        }
     }
+    cout << "Balance below Nisab, no Zakat due\n";
 }
 
 template<typename B>
@@ -284,6 +297,12 @@ void SavingAccount<B>::setZakat(B zakat)
     this->zakat = zakat;
 }
 
+template<typename B>
+bool SavingAccount<B>::getCanWithdraw() const
+{
+    return canWithdraw;
+}
+
 
 
 
@@ -306,14 +325,13 @@ template<typename B>
 // Overriding withdraw function
 B BusinessAccount<B>::withdraw(B amount) 
 {
-    if (amount > this->balance)
+    if (!this->balance->tryWithdraw(amount))
     {
         cout << "Insufficient balance!" << endl;
         return 0;
     }
-    this->balance -= amount;
     cout << "Withdrawal successful from business account!" << endl;
-    return 1;
+    return amount;
 }
 
 template<typename B>
@@ -429,6 +447,12 @@ Transaction::Transaction(string fromAcc, string toAcc, double amt, string stat,
 {
 }
 
+Transaction::Transaction(string fromAcc, string toAcc, double amt, string stat, string type, time_t date)
+    : fromAccount(fromAcc), toAccount(toAcc), amount(amt),
+      status(stat), transactionType(type), transactionDate(date)
+{
+}
+
 // Getters
 string Transaction::getFromAccount() const
 {
@@ -471,70 +495,67 @@ void Transaction::setTransactionType(string newType)
     transactionType = newType;
 }
 
-// Save to JSON
-void Transaction::saveTransaction(const string& filename)
+// Conversion to the journal record
+JournalRecord Transaction::toRecord() const
 {
-    json j;
+    JournalRecord record;
+    record.fromAccount = fromAccount;
+    record.toAccount = toAccount;
+    record.amount = amount;
+    record.status = status;
+    record.transactionType = transactionType;
+    record.date = static_cast<int64_t>(transactionDate);
+    return record;
+}
 
-    ifstream inFile(filename);
-    if (inFile.is_open())
-    {
-        inFile >> j;
-        inFile.close();
-    }
+// Conversion from the journal record
+Transaction Transaction::fromRecord(const JournalRecord& record)
+{
+    return Transaction(record.fromAccount, record.toAccount, record.amount,
+                       record.status, record.transactionType,
+                       static_cast<time_t>(record.date));
+}
 
-    j.push_back({
-        {"fromAccount", fromAccount},
-        {"toAccount", toAccount},
-        {"amount", amount},
-        {"status", status},
-        {"transactionType", transactionType},
-        {"date", static_cast<long long>(transactionDate)}  // Explicitly cast to long long
-    });
+// Queue for the journal writer thread
+uint64_t Transaction::saveTransaction(const string& filename)
+{
+    return JournalQueue::shared(filename).enqueue(toRecord());
+}
 
-    ofstream outFile(filename);
-    outFile << j.dump(4);
-    outFile.close();
+// Stream one page of matching transactions
+TransactionPage Transaction::queryTransactions(const TransactionFilter& filter, uint64_t cursor, size_t limit,
+                                               const function<void(const Transaction&)>& fn, const string& filename)
+{
+    JournalQueue::shared(filename).flush();     // include records still in the queue
+    return Banking::queryTransactions(filename, filter, cursor, limit, [&fn](const JournalRecord& record) {
+        fn(fromRecord(record));
+    });
 }
 
-// Static function to load transactions
-void Transaction::loadTransactions(const string& filename)
+// Static function to print one page of transactions
+TransactionPage Transaction::loadTransactions(const TransactionFilter& filter, uint64_t cursor, size_t limit,
+                                              const string& filename)
 {
-    ifstream file(filename);
-    if (!file.is_open())
+    TransactionPage page = queryTransactions(filter, cursor, limit, [](const Transaction& trans) {
+        time_t transDate = trans.getTransactionDate();
+        cout << "From: " << trans.getFromAccount()
+             << " | To: " << trans.getToAccount()
+             << " | Amount: $" << trans.getAmount()
+             << " | Type: " << trans.getTransactionType()
+             << " | Status: " << trans.getStatus()
+             << " | Date: " << ctime(&transDate);
+    }, filename);
+    if (page.count == 0 && cursor == firstPage)
     {
-        cout << "No transactions recorded yet.\n";
-        return;
+        cout << "No matching transactions.\n";
     }
-    json j;
-    file >> j;
-    file.close();
-    for (auto& trans : j)
-    {
-        // Extract time_t value from JSON
-        time_t transDate;
-
-        // Handle both integer and string representations
-        if (trans["date"].is_number())
-        {
-            transDate = trans["date"].get<time_t>();
-        } 
-        else if (trans["date"].is_string())
-        {
-            string dateStr = trans["date"].get<string>();
-            transDate = stol(dateStr);
-        } 
-        else
-        {
-            transDate = time(nullptr);  // Default to current time if invalid
-        }
+    return page;
+}
 
-        cout << "From: " << trans["fromAccount"].get<string>() 
-             << " | To: " << trans["toAccount"].get<string>()
-             << " | Amount: $" << trans["amount"].get<double>()
-             << " | Type: " << trans["transactionType"].get<string>()
-             << " | Date: " << ctime(&transDate);
-    }
+// Import legacy JSON history into the journal
+size_t Transaction::importTransactions(const string& jsonFile, const string& journalFile)
+{
+    return TransactionJournal::importJson(jsonFile, journalFile);
 }
 
 // Explicit template instantiation for common types
@@ -545,4 +566,11 @@ template class SavingAccount<float>;
 template class BusinessAccount<double>;
 template class BusinessAccount<float>;
 template class Bank<double>;
-template class Bank<float>;
\ No newline at end of file
+template class Bank<float>;
+template class BankAccount<Money>;
+template class SavingAccount<Money>;
+template class BusinessAccount<Money>;
+template class Bank<Money>;
+template void BankMember::paySalary<double>(Bank<double>* bank);
+template void BankMember::paySalary<float>(Bank<float>* bank);
+template void BankMember::paySalary<Money>(Bank<Money>* bank);
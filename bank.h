@@ -5,11 +5,39 @@
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <sstream>
 #include <vector>
 #include <map>
 #include <ctime>
+#include <cstring>
 #include <algorithm>
 #include <stdexcept>
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <functional>
+#include <thread>
+#include "account_index.h"
+#include "account_store.h"
+#include "batch_file.h"
+#include "customer_store.h"
+#include "interest.h"
+#include "journal.h"
+#include "journal_queue.h"
+#include "money.h"
+#include "persistence.h"
+#include "snapshot.h"
+#include "statement.h"
+#include "reconcile.h"
+#include "checkpoint.h"
+#include "segment.h"
+#include "query.h"
+#include "sax_loader.h"
 
 using namespace std;
 using json = nlohmann::json;
@@ -168,9 +196,12 @@ template<typename B>
 class BankAccount
 {
 protected:
- B balance;
+ BalanceCell<B>* balance;                // hot column cell once stored, else &ownBalance
+ BalanceCell<B> ownBalance;
  string accountNumber;
- PersonalInfo customerInfo;              // Composition with PersonalInfo struct
+ CustomerStore* infoStore;               // cold store holding the PersonalInfo, or null
+ uint32_t infoRow;
+ unique_ptr<PersonalInfo> ownInfo;       // PersonalInfo while not in a store
 
 public:
 // Default constructor
@@ -178,11 +209,15 @@ public:
  // parametarized constructor
  BankAccount(string accountNum, B balance, PersonalInfo info);
  
- //----- Copy constructor (deep copy)------
+ //----- Copy constructor (deep copy, the copy owns its data)------
  BankAccount(const BankAccount& other);
+ BankAccount& operator=(const BankAccount&) = delete;
 
  virtual ~BankAccount() {}               // Virtual destructor for proper cleanup
 
+ // Move balance and PersonalInfo into an AccountStore row (called by the store)
+ void attach(BalanceCell<B>* balanceCell, CustomerStore* customers, uint32_t row);
+
  // Setters functions:
  void setAccountNumber(const string& accountNum);
  void setBalance(B balance);
@@ -242,289 +277,1954 @@ public:
 };
 
 
+// Result of Bank::runZakatCycle: one line per account charged (or, in a dry run, due)
+template<typename B>
+struct ZakatReport
+{
+ struct Line
+ {
+     string accountNumber;
+     B balanceBefore;
+     B zakat;
+ };
+
+ bool dryRun = false;
+ size_t savingAccounts = 0;       // saving accounts scanned
+ size_t belowNisab = 0;
+ size_t skipped = 0;              // balance fell below the zakat before it could be taken
+ B totalZakat = B();
+ vector<Line> lines;
+ double elapsedMs = 0;
+};
+
+// Result of Bank::runInterestAccrual; counts only, so it stays small on any book
+template<typename B>
+struct InterestReport
+{
+ int32_t day = 0;                 // accrual day, see accrualDayOf()
+ bool dryRun = false;
+ size_t savingAccounts = 0;
+ size_t credited = 0;
+ size_t alreadyAccrued = 0;       // credited for this day by an earlier or interrupted run
+ size_t recovered = 0;            // credits of an interrupted run taken from its journal records
+ size_t noInterest = 0;           // below the first paying tier or rounded to zero
+ B totalInterest = B();
+ size_t windows = 0;              // delta batches written
+ double elapsedMs = 0;
+};
+
+// Result of Bank::runPayroll: one credit per destination account
+template<typename B>
+struct PayrollReport
+{
+ struct Credit
+ {
+     string accountNumber;
+     size_t employees = 0;
+     B amount = B();
+ };
+
+ size_t employees = 0;            // distinct employees selected
+ size_t duplicates = 0;           // repeated employee IDs, paid once
+ size_t paid = 0;
+ B totalPaid = B();
+ vector<Credit> credits;
+ vector<string> failures;         // "employeeID: reason" for everyone not paid
+ size_t threads = 0;
+ double elapsedMs = 0;
+};
+
+// One validated record for Bank::applyBatch
+template<typename B>
+struct BatchOp
+{
+ BatchOpType type;
+ string account;
+ string toAccount;
+ B amount;
+};
+
+// Result of Bank::applyBatchFile
+struct BatchSummary
+{
+ size_t records = 0;
+ size_t applied = 0;
+ size_t failed = 0;
+ double elapsedMs = 0;
+
+ double perSecond() const { return elapsedMs > 0 ? records / (elapsedMs / 1000.0) : 0; }
+};
+
+// Result of Bank::settleNetted: the net change per account, applied all or nothing
+template<typename B>
+struct SettlementReport
+{
+ struct Position
+ {
+     string accountNumber;
+     B net = B();                 // credits minus debits over the batch
+     size_t legs = 0;             // transfers touching the account
+ };
+
+ bool settled = false;
+ size_t transfers = 0;
+ size_t mutations = 0;            // balance changes (and journal records) applied
+ B grossVolume = B();             // sum of all transfer amounts
+ B netVolume = B();               // sum of the net debits
+ vector<Position> positions;      // every account touched, in first-seen order
+ vector<string> violations;       // why the batch was not settled
+ double elapsedMs = 0;
+};
+
+
+// -----------------------------------------Bank class(Singleton)-----------------------------
+template<typename B>
+class Bank
+{
+private:
+ // Locking. accountsMutex guards the shape of the book (store, index, file name,
+ // persistence options): every account operation holds it shared, and only adding,
+ // removing or reloading accounts holds it exclusively, for the few microseconds the
+ // store and index change. Balances are atomic cells: deposits and withdrawals change
+ // them without any further lock. Operations that must see or change more than one
+ // thing at once (transfer, zakat, full images) take the stripe lock of each row
+ // involved. A cut that must match the journal (a balance checkpoint) holds
+ // accountsMutex exclusively, since every operation journals before releasing it.
+ // persistMutex serializes the delta log. Order: accountsMutex, then persistMutex,
+ // then stripe locks in ascending stripe order.
+ struct alignas(64) Stripe
+ {
+     mutex lock;
+     unordered_set<string> dirty;             // accounts of this stripe changed since the last batch
+ };
+ static const size_t stripeCount = 64;
+
+ static Bank* instance;
+ static once_flag instanceFlag;
+ mutable shared_mutex accountsMutex;
+ mutable array<Stripe, stripeCount> stripes;
+ mutex persistMutex;
+ atomic<size_t> dirtyCount{0};              // entries in all stripe dirty sets
+ atomic<int64_t> oldestDirty{0};            // steady clock ns of the first change in the batch
+ AccountStore<B> store;                     // accounts by row: hot columns, objects, cold info
+ AccountIndex<uint32_t> accountIndex;       // open-addressing index, account number -> row
+ string filename = "accounts.json";         // json file to store accounts data
+ PersistenceOptions persistence;            // batching and durability of account writes
+ unique_ptr<DeltaLog> deltaLog;             // committed changes made since filename was written
+ chrono::steady_clock::time_point lastSync;
+ bool unsyncedChanges = false;
+ unique_ptr<CheckpointLog> checkpointLog;   // balance checkpoints along transactionsFile
+ unordered_set<string> changedSinceCheckpoint;  // accounts changed since the last checkpoint
+ bool fullCheckpointDue = true;             // the next checkpoint lists every account
+ atomic<bool> checkpointDue{false};         // noteCheckpointDue() found one due, see checkpointIfDue()
+ uint64_t checkpointFailedAt = 0;           // journal end when a checkpoint last failed
+ atomic<int64_t> archiveCutoff{0};          // archive segments dated before it, 0 = none due (archiveIfDue())
+ atomic<TransactionJournal*> archiveJournal{nullptr};   // journal archiveCutoff is for
+ atomic<bool> archiving{false};             // an archiveIfDue() is copying a segment
+ mutex accrualMutex;                        // one interest run at a time (it owns the marker file)
+ mutable mutex employeesMutex;
+ vector<BankMember> employees;
+ string employeesFile = "employees.json";   // json file to store Employee data
+ mutable mutex usersMutex;
+ map<string, User> users;                // username -> User
+ string usersFile = "users.json";                // json file to store user data
+ string transactionsFile = "transactions.journal";  // journal that transfers are recorded in
+
+ // Private constructor
+ Bank()
+ {
+    // Exception handling for file loading
+    // Load accounts, employees, and users from files
+    try {
+        loadAccountsFromFile();
+        loadEmployeesFromFile();
+        loadUsersFromFile();
+    } catch (const Exceptions::FileException& e) {
+        cerr << "Initialization error: " << e.what() << endl;
+    }
+}
+
+public:
+ // Static function to get instance (thread-safe, the first caller loads the files)
+ static Bank* getInstance()
+ {
+     call_once(instanceFlag, []() { instance = new Bank(); });
+     return instance;
+ }
+
+ // Destructor: write pending changes, then release the accounts
+ ~Bank()
+ {
+     try {
+         flush();
+     } catch (const exception& e) {
+         cerr << "Error flushing accounts: " << e.what() << endl;
+     }
+     clearAccounts();
+ }
+ // Visit every account. The callback is called with the concrete type
+ // (SavingAccount<B>& or BusinessAccount<B>&), so it should be a generic lambda.
+ // Transfers, interest and zakat wait until the visit is over, but deposits and
+ // withdrawals take no stripe lock, so a balance may change while it is visited.
+ template<typename F>
+ void forEachAccount(F&& fn)
+ {
+     shared_lock<shared_mutex> lock(accountsMutex);
+     auto stripeLocks = lockAllStripes();
+     store.forEach(fn);
+ }
+
+ // Visit every account's hot columns as fn(row, balance, type) without loading account
+ // objects or customer data. Balances changed here are not persisted by themselves.
+ // As with forEachAccount, deposits and withdrawals may move a balance during the
+ // visit, so change one with add() or tryWithdraw() rather than load() and store().
+ template<typename F>
+ void forEachBalance(F&& fn)
+ {
+     shared_lock<shared_mutex> lock(accountsMutex);
+     auto stripeLocks = lockAllStripes();
+     store.forEachHot(fn);
+ }
+
+ // Sum of all balances, read from the balance column only
+ B totalBalance()
+ {
+     shared_lock<shared_mutex> lock(accountsMutex);
+     auto stripeLocks = lockAllStripes();
+     B total = B();
+     store.forEachHotChunk([&total](HotSpan<B>& span) {
+         for (uint32_t i = 0; i < span.count; i++) {
+             if (span.flags[i] & HotLive) total += span.balances[i].load();
+         }
+     });
+     return total;
+ }
+
+ size_t accountCount() const
+ {
+     shared_lock<shared_mutex> lock(accountsMutex);
+     return store.size();
+ }
+
+ map<string, User> getUsers() const
+ {
+     lock_guard<mutex> lock(usersMutex);
+     return users;
+ }
+
+ // Find account using the index. The pointer stays valid until the account is
+ // removed; concurrent callers should change balances through deposit/withdraw.
+ BankAccount<B>* findAccount(const string& accNum)
+ {
+     shared_lock<shared_mutex> lock(accountsMutex);
+     return findAccountLocked(accNum);
+ }
+
+ // Remove account
+ void removeAccount(const string& accNum)
+ {
+     {
+         unique_lock<shared_mutex> lock(accountsMutex);
+         uint32_t* row = accountIndex.find(accNum);
+         if (!row) return;
+         Stripe& stripe = stripeFor(*row);
+         eraseAccount(accNum);
+         addDirty(stripe, accNum);     // no row any more: written as a removal
+     }
+     shared_lock<shared_mutex> lock(accountsMutex);
+     maybeFlush();
+ }
+
+ // Create account (factory method)
+ BankAccount<B>* createAccount(const string& accNum, B balance, const string& type, PersonalInfo info)
+ {
+     BankAccount<B>* acc;
+     {
+         unique_lock<shared_mutex> lock(accountsMutex);
+         // Check if account already exists
+         if (findAccountLocked(accNum)) {
+             throw Exceptions::AccountException("Account number already exists");
+         }
+         uint32_t row = makeAccount(accNum, balance, type, info);
+         if (row == noAccountRow) return nullptr;
+         markDirtyLocked(row, accNum);
+         acc = store.get(row);
+     }
+     shared_lock<shared_mutex> lock(accountsMutex);
+     maybeFlush();
+     return acc;
+ }
+
+ // Deposit into an account, journal it as transactionType and queue the new balance
+ // for persistence. Lock-free: the balance is one atomic add, and an account that is
+ // already dirty is not re-marked. The record is queued before accountsMutex is
+ // released, so a checkpoint never sees the balance without it.
+ B deposit(const string& accNum, B amount, const string& transactionType = "Deposit")
+ {
+     B newBalance;
+     {
+         shared_lock<shared_mutex> lock(accountsMutex);
+         uint32_t* row = accountIndex.find(accNum);
+         if (!row) {
+             throw Exceptions::AccountException("Account not found");
+         }
+         newBalance = store.get(*row)->updateBalance(amount);
+
+         JournalRecord record;
+         record.fromAccount = "Bank";
+         record.toAccount = accNum;
+         record.amount = AmountTraits<B>::toDouble(amount);
+         record.status = "Completed";
+         record.transactionType = transactionType;
+         record.date = static_cast<int64_t>(time(nullptr));
+         JournalQueue::shared(transactionsFile).enqueue(move(record));
+
+         markDirty(*row, accNum);
+         maybeFlush();
+     }
+     deferredWork();
+     return newBalance;
+ }
+
+ // Withdraw from an account, journal it and queue the new balance for persistence.
+ // Returns what the account paid out (0 when the withdrawal was refused).
+ // Lock-free: the account withdraws with a compare-and-swap loop that never lets
+ // the balance go below zero. Journaled like deposit().
+ B withdraw(const string& accNum, B amount)
+ {
+     B paid;
+     {
+         shared_lock<shared_mutex> lock(accountsMutex);
+         uint32_t* row = accountIndex.find(accNum);
+         if (!row) {
+             throw Exceptions::AccountException("Account not found");
+         }
+         paid = store.get(*row)->withdraw(amount);
+         if (paid > B()) {
+             JournalRecord record;
+             record.fromAccount = accNum;
+             record.toAccount = "Bank";
+             record.amount = AmountTraits<B>::toDouble(paid);
+             record.status = "Completed";
+             record.transactionType = "Withdrawal";
+             record.date = static_cast<int64_t>(time(nullptr));
+             JournalQueue::shared(transactionsFile).enqueue(move(record));
+             markDirty(*row, accNum);
+         }
+         maybeFlush();
+     }
+     deferredWork();
+     return paid;
+ }
+
+ // Move amount from one account to another as a single step: both stripe locks are
+ // taken (in ascending stripe order, so two opposite transfers cannot deadlock) before
+ // either balance changes, and the transfer is journaled as one record while they are
+ // held. Returns false, changing nothing, when the source account refuses the
+ // withdrawal; insufficient funds throw from the account as for withdraw().
+ bool transfer(const string& fromAcc, const string& toAcc, B amount)
+ {
+     if (amount <= B()) {
+         throw Exceptions::TransactionException("Transfer amount must be positive");
+     }
+     if (fromAcc == toAcc) {
+         throw Exceptions::TransactionException("Cannot transfer to the same account");
+     }
+
+     shared_lock<shared_mutex> lock(accountsMutex);
+     uint32_t* fromRow = accountIndex.find(fromAcc);
+     uint32_t* toRow = accountIndex.find(toAcc);
+     if (!fromRow || !toRow) {
+         throw Exceptions::AccountException("One or both accounts not found");
+     }
+     {
+         Stripe& first = stripeFor(min(*fromRow % stripeCount, *toRow % stripeCount));
+         Stripe& second = stripeFor(max(*fromRow % stripeCount, *toRow % stripeCount));
+         unique_lock<mutex> firstLock(first.lock);
+         unique_lock<mutex> secondLock;
+         if (&second != &first) secondLock = unique_lock<mutex>(second.lock);
+
+         B paid = store.get(*fromRow)->withdraw(amount);
+         if (paid != amount) return false;
+         store.get(*toRow)->updateBalance(amount);
+
+         JournalRecord record;
+         record.fromAccount = fromAcc;
+         record.toAccount = toAcc;
+         record.amount = AmountTraits<B>::toDouble(amount);
+         record.status = "Completed";
+         record.transactionType = "Transfer";
+         record.date = static_cast<int64_t>(time(nullptr));
+         JournalQueue::shared(transactionsFile).enqueue(move(record));
+
+         markDirtyLocked(*fromRow, fromAcc);
+         markDirtyLocked(*toRow, toAcc);
+     }
+     maybeFlush();
+     lock.unlock();
+     deferredWork();
+     return true;
+ }
+
+ // Batching and durability settings for account persistence
+ void setPersistenceOptions(const PersistenceOptions& options)
+ {
+     {
+         unique_lock<shared_mutex> lock(accountsMutex);
+         persistence = options;
+     }
+     shared_lock<shared_mutex> lock(accountsMutex);
+     maybeFlush();
+ }
+ PersistenceOptions getPersistenceOptions() const
+ {
+     shared_lock<shared_mutex> lock(accountsMutex);
+     return persistence;
+ }
+
+ // Durability barrier: every change made before the call is written to the delta log
+ // (and synced unless durability is None) when it returns
+ void flush()
+ {
+     {
+         shared_lock<shared_mutex> lock(accountsMutex);
+         lock_guard<mutex> persistLock(persistMutex);
+         writeDirtyBatch(persistence.durability != Durability::None);
+     }
+     deferredWork();
+ }
+
+ private:
+ Stripe& stripeFor(uint32_t row) const { return stripes[row % stripeCount]; }
+
+ // Lock every stripe in ascending order; balances stay still until the locks go away
+ vector<unique_lock<mutex>> lockAllStripes() const
+ {
+     vector<unique_lock<mutex>> locks;
+     locks.reserve(stripeCount);
+     for (auto& stripe : stripes) locks.emplace_back(stripe.lock);
+     return locks;
+ }
+
+ // applyBatch without the flush check; the caller decides when images go out
+ size_t applyBatchUnflushed(const vector<BatchOp<B>>& ops, vector<string>& errors)
+ {
+     errors.assign(ops.size(), string());
+     size_t applied = 0;
+     shared_lock<shared_mutex> lock(accountsMutex);
+     {
+         auto stripeLocks = lockAllStripes();
+         JournalQueue& journal = JournalQueue::shared(transactionsFile);
+         int64_t now = static_cast<int64_t>(time(nullptr));
+         for (size_t i = 0; i < ops.size(); i++) {
+             const BatchOp<B>& op = ops[i];
+             string& error = errors[i];
+             if (op.amount <= B()) {
+                 error = "Amount must be positive";
+                 continue;
+             }
+             uint32_t* row = accountIndex.find(op.account);
+             if (!row) {
+                 error = "Account not found: " + op.account;
+                 continue;
+             }
+
+             JournalRecord record;
+             record.amount = AmountTraits<B>::toDouble(op.amount);
+             record.status = "Completed";
+             record.date = now;
+             try {
+                 if (op.type == BatchOpType::Deposit) {
+                     store.balanceAt(*row).add(op.amount);
+                     record.fromAccount = "Bank";
+                     record.toAccount = op.account;
+                     record.transactionType = "Deposit";
+                 } else {
+                     if (store.typeAt(*row) == HotSaving
+                         && !static_cast<SavingAccount<B>*>(store.get(*row))->getCanWithdraw()) {
+                         error = "Withdrawals not allowed for account " + op.account;
+                         continue;
+                     }
+                     uint32_t* toRow = nullptr;
+                     if (op.type == BatchOpType::Transfer) {
+                         toRow = accountIndex.find(op.toAccount);
+                         if (!toRow) {
+                             error = "Account not found: " + op.toAccount;
+                             continue;
+                         }
+                         if (*toRow == *row) {
+                             error = "Cannot transfer to the same account";
+                             continue;
+                         }
+                     }
+                     if (!store.balanceAt(*row).tryWithdraw(op.amount)) {
+                         error = "Insufficient balance in account " + op.account;
+                         continue;
+                     }
+                     record.fromAccount = op.account;
+                     if (toRow) {
+                         try {
+                             store.balanceAt(*toRow).add(op.amount);
+                         } catch (...) {
+                             store.balanceAt(*row).add(op.amount);     // put the debit back
+                             throw;
+                         }
+                         markDirtyLocked(*toRow, op.toAccount);
+                         record.toAccount = op.toAccount;
+                         record.transactionType = "Transfer";
+                     } else {
+                         record.toAccount = "Bank";
+                         record.transactionType = "Withdrawal";
+                     }
+                 }
+             } catch (const exception& e) {
+                 error = e.what();
+                 continue;
+             }
+             markDirtyLocked(*row, op.account);
+             journal.enqueue(move(record));
+             applied++;
+         }
+     }
+     return applied;
+ }
+
+
+ // Zakat due for n balances: 2.5% where the row is a saving account at or above the
+ // nisab of SavingAccount::calculateZakat, zero elsewhere. Plain arrays in and out and
+ // no data-dependent branches, so the compiler can vectorize the loop.
+ static void zakatKernel(const B* balances, const uint8_t* saving, B* due, uint32_t n)
+ {
+     const B nisab = B(20000);
+     for (uint32_t i = 0; i < n; i++) {
+         B zakat = AmountTraits<B>::mulDiv(balances[i], 25, 1000, Rounding::HalfEven);
+         due[i] = (saving[i] && balances[i] >= nisab) ? zakat : B();
+     }
+ }
+
+ // Statements and journal amounts are kept in Money whatever the book's amount type
+ static Money toMoney(B amount)
+ {
+     if constexpr (is_same<B, Money>::value) return amount;
+     else return Money::fromDouble(AmountTraits<B>::toDouble(amount));
+ }
+
+ static B fromMoney(Money amount)
+ {
+     if constexpr (is_same<B, Money>::value) return amount;
+     else return AmountTraits<B>::fromDouble(amount.toDouble());
+ }
+
+ static int64_t steadyNowNs()
+ {
+     return chrono::duration_cast<chrono::nanoseconds>(
+         chrono::steady_clock::now().time_since_epoch()).count();
+ }
+
+ // Index lookup; the caller holds accountsMutex
+ BankAccount<B>* findAccountLocked(const string& accNum)
+ {
+     uint32_t* row = accountIndex.find(accNum);
+     return row ? store.get(*row) : nullptr;
+ }
+
+ // Build an account inside the store and index it, without persisting anything.
+ // Returns its row, or noAccountRow for an unknown type or a number that is already taken.
+ uint32_t makeAccount(const string& accNum, B balance, const string& type, const PersonalInfo& info)
+ {
+     // Exception handling for account creation
+     if (accNum.empty()) {
+         throw Exceptions::AccountException("Account number cannot be empty");
+     }
+     if (balance < 0) {
+         throw Exceptions::AccountException("Initial balance cannot be negative");
+     }
+
+     uint32_t row;
+     if (type == "Saving")
+     {
+         row = store.emplaceSaving(accNum, balance, info, B(), 0, true);
+     }
+     else if (type == "Business")
+     {
+         row = store.emplaceBusiness(accNum, balance, info, "LinkedSystem");
+     }
+     else
+     {
+         cout << "Invalid account type!" << endl;
+         return noAccountRow;
+     }
+
+     if (!accountIndex.insert(accNum, row)) {
+         cerr << "Skipping duplicate account " << accNum << " in " << filename << endl;
+         store.erase(row);
+         return noAccountRow;
+     }
+     return row;
+ }
+
+ // Delete an account from store and index without persisting anything
+ bool eraseAccount(const string& accNum)
+ {
+     uint32_t* row = accountIndex.find(accNum);
+     if (!row) return false;
+
+     store.erase(*row);
+     accountIndex.erase(accNum);
+     return true;
+ }
+
+ // Drop every account held in memory (used before reloading the book)
+ void clearAccounts()
+ {
+     store.clear();
+     accountIndex.clear();
+     for (auto& stripe : stripes) stripe.dirty.clear();
+     dirtyCount = 0;
+     changedSinceCheckpoint.clear();
+     fullCheckpointDue = true;
+ }
+
+ // Remember that an account changed; the change is written with the next batch.
+ // The caller holds the stripe lock (or accountsMutex exclusively).
+ void addDirty(Stripe& stripe, const string& accNum)
+ {
+     if (stripe.dirty.insert(accNum).second && dirtyCount.fetch_add(1) == 0) {
+         oldestDirty = steadyNowNs();
+     }
+ }
+
+ // Same for an account that still has a row, whose stripe lock the caller holds.
+ // The row's HotDirty flag says the account is already queued.
+ void markDirtyLocked(uint32_t row, const string& accNum)
+ {
+     if (!(store.flagsAt(row).fetch_or(HotDirty) & HotDirty)) {
+         addDirty(stripeFor(row), accNum);
+     }
+ }
+
+ // Same without holding the stripe lock: only the clean -> dirty transition takes it,
+ // so changes to an account that is already queued cost one atomic load. The batch
+ // writer clears the flag before it reads the balance, so a change is never lost.
+ void markDirty(uint32_t row, const string& accNum)
+ {
+     atomic<uint8_t>& flags = store.flagsAt(row);
+     if (flags.load() & HotDirty) return;
+     if (!(flags.fetch_or(HotDirty) & HotDirty)) {
+         lock_guard<mutex> guard(stripeFor(row).lock);
+         addDirty(stripeFor(row), accNum);
+     }
+ }
+
+ // Write a batch once enough accounts are dirty or the oldest change is old enough.
+ // The caller holds accountsMutex and no stripe lock. When another thread is already
+ // writing a batch this returns at once; that batch picks the changes up.
+ void maybeFlush()
+ {
+     size_t pending = dirtyCount.load(memory_order_relaxed);
+     if (pending == 0) return;
+     if (pending < persistence.batchSize &&
+         steadyNowNs() - oldestDirty.load(memory_order_relaxed) <
+             chrono::duration_cast<chrono::nanoseconds>(persistence.flushInterval).count()) {
+         return;
+     }
+     unique_lock<mutex> persistLock(persistMutex, try_to_lock);
+     if (persistLock.owns_lock()) writeDirtyBatch(false);
+ }
+
+ // Append the current image of every dirty account (or a removal marker) to the delta
+ // log as one committed batch, then compact once the log outgrows the book.
+ // The caller holds accountsMutex and persistMutex.
+ void writeDirtyBatch(bool forceSync)
+ {
+     if (!deltaLog) {
+         deltaLog.reset(new DeltaLog(DeltaLog::pathFor(filename)));
+     }
+
+     auto now = chrono::steady_clock::now();
+     bool syncNow = forceSync
+         || persistence.durability == Durability::EveryBatch
+         || (persistence.durability == Durability::Interval && now - lastSync >= persistence.syncInterval);
+
+     if (dirtyCount.load() > 0) {
+         vector<string> lines;
+         for (size_t s = 0; s < stripeCount; s++) {
+             Stripe& stripe = stripes[s];
+             lock_guard<mutex> guard(stripe.lock);
+             for (const auto& accNum : stripe.dirty) {
+                 uint32_t* row = accountIndex.find(accNum);
+                 if (!row) {
+                     lines.push_back(json{{"accountNumber", accNum}, {"removed", true}}.dump());
+                 } else if (*row % stripeCount == s) {
+                     store.flagsAt(*row).fetch_and(static_cast<uint8_t>(~HotDirty));
+                     lines.push_back(accountToJson(*row, store.balanceAt(*row).load()).dump());
+                 }
+                 // else: removed and created again on another stripe, written from there
+             }
+             dirtyCount -= stripe.dirty.size();
+             if (persistence.checkpointBytes) changedSinceCheckpoint.insert(stripe.dirty.begin(), stripe.dirty.end());
+             stripe.dirty.clear();
+         }
+         if (!lines.empty()) {
+             deltaLog->appendBatch(lines, false);
+             unsyncedChanges = true;
+         }
+     }
+     if (syncNow && unsyncedChanges) {
+         deltaLog->sync();
+         lastSync = now;
+         unsyncedChanges = false;
+     }
+
+     if (deltaLog->recordCount() > max(persistence.compactionMinRecords, store.size())) {
+         writeAccountsFile();
+     }
+     noteCheckpointDue();
+     noteArchiveDue();
+ }
+
+ // Note the cutoff for archiving the sealed journal days older than archiveAfterDays
+ // (see archive.h); archiveIfDue() copies them once the operation is over. The caller
+ // holds accountsMutex and persistMutex.
+ void noteArchiveDue()
+ {
+     if (persistence.archiveAfterDays <= 0) return;
+     archiveJournal = &TransactionJournal::shared(transactionsFile);
+     archiveCutoff = static_cast<int64_t>(time(nullptr))
+         - static_cast<int64_t>(persistence.archiveAfterDays) * SegmentCatalog::segmentSeconds;
+ }
+
+ // Copy at most one due journal segment into the columnar archive, outside every lock
+ // of the Bank. Usually nothing is due; a backlog (the first run over an old journal)
+ // goes one segment per operation instead of stalling one of them. Only one caller
+ // archives at a time, the others go on. A failure is reported and retried after the
+ // next batch. The caller holds no lock.
+ void archiveIfDue()
+ {
+     int64_t cutoff = archiveCutoff.load(memory_order_relaxed);
+     if (cutoff == 0 || archiving.exchange(true)) return;
+     try {
+         JournalArchiveSummary done = archiveJournal.load()->archiveSegments(cutoff, 1);
+         if (done.segments + done.skipped == 0) archiveCutoff.compare_exchange_strong(cutoff, 0);
+     } catch (const exception& e) {
+         archiveCutoff.compare_exchange_strong(cutoff, 0);
+         cerr << "Error archiving journal segments: " << e.what() << endl;
+     }
+     archiving = false;
+ }
+
+ // Work a batch asked for that must not run inside an operation: a due checkpoint,
+ // then one segment of a due archive. The caller holds no lock.
+ void deferredWork()
+ {
+     checkpointIfDue();
+     archiveIfDue();
+ }
+
+ // Note that a balance checkpoint is due once the journal has grown checkpointBytes
+ // past the last. It is not taken here: a lock-free deposit may be between its balance
+ // change and its journal record, so checkpointIfDue() takes it once the operation is
+ // over. The caller holds accountsMutex and persistMutex.
+ void noteCheckpointDue()
+ {
+     if (persistence.checkpointBytes == 0) return;
+     // A log not opened yet is opened by checkpointIfDue(), where a failure is caught
+     uint64_t last = checkpointLog && checkpointLog->size() ? checkpointLog->at(checkpointLog->size() - 1).journalOffset : 0;
+     last = max(last, checkpointFailedAt);
+     uint64_t end = TransactionJournal::shared(transactionsFile).size();
+     if (end > last && end - last >= persistence.checkpointBytes) checkpointDue = true;
+ }
+
+ // Take the checkpoint noteCheckpointDue() asked for, with accountsMutex held
+ // exclusively so that no operation is part way through. Only one caller takes it.
+ // The operation that runs it has already committed, so a failure is reported here
+ // and the checkpoint is tried again (listing every account) once the journal has
+ // grown checkpointBytes past the failure. The caller holds no lock.
+ void checkpointIfDue()
+ {
+     if (!checkpointDue.load(memory_order_relaxed) || !checkpointDue.exchange(false)) return;
+     unique_lock<shared_mutex> lock(accountsMutex);
+     lock_guard<mutex> persistLock(persistMutex);
+     try {
+         openCheckpointLog();
+         writeCheckpoint();
+     } catch (const exception& e) {
+         fullCheckpointDue = true;          // the accounts changed since the last one are forgotten
+         checkpointFailedAt = TransactionJournal::shared(transactionsFile).size();
+         cerr << "Error writing balance checkpoint: " << e.what() << endl;
+     }
+ }
+
+ void openCheckpointLog()
+ {
+     if (!checkpointLog) {
+         checkpointLog.reset(new CheckpointLog(CheckpointLog::pathFor(transactionsFile)));
+     }
+ }
+
+ // Append the balances at the current end of the journal to the checkpoint log: every
+ // account when a full checkpoint is due (the first of the process, whose change set
+ // starts empty, and every fullCheckpointEvery-th), else those changed since the last.
+ // Every operation queues its journal records before it releases accountsMutex, so with
+ // accountsMutex held exclusively and the journal queue drained, each balance belongs
+ // to exactly the records before the checkpoint's offset. (Changes nobody journals,
+ // such as a single account's zakat, are in the balance either way.) Accounts still in
+ // a stripe's dirty set count as changed too. Account numbers too long for an entry
+ // are left out; their queries replay from the live balance.
+ // The caller holds accountsMutex exclusively and persistMutex.
+ void writeCheckpoint()
+ {
+     bool full = fullCheckpointDue || (checkpointLog->size() + 1) % fullCheckpointEvery == 0;
+     vector<CheckpointEntry> entries;
+     uint64_t journalOffset;
+     {
+         JournalQueue::shared(transactionsFile).flush();
+         journalOffset = TransactionJournal::shared(transactionsFile).size();
+         auto add = [&entries](const string& accNum, B balance) {
+             if (accNum.size() >= snapshotAccountNumberSize) return;
+             CheckpointEntry entry = {};
+             memcpy(entry.accountNumber, accNum.data(), accNum.size());
+             entry.balance = toMoney(balance).minorUnits();
+             entries.push_back(entry);
+         };
+         if (full) {
+             entries.reserve(store.size());
+             store.forEachHot([this, &add](uint32_t row, BalanceCell<B>& balance, uint8_t) {
+                 add(store.get(row)->getAccountNumber(), balance.load());
+             });
+         } else {
+             for (auto& stripe : stripes) changedSinceCheckpoint.insert(stripe.dirty.begin(), stripe.dirty.end());
+             entries.reserve(changedSinceCheckpoint.size());
+             for (const string& accNum : changedSinceCheckpoint) {
+                 if (uint32_t* row = accountIndex.find(accNum)) add(accNum, store.balanceAt(*row).load());
+             }
+         }
+         changedSinceCheckpoint.clear();
+     }
+     checkpointLog->append(journalOffset, full, entries, persistence.durability != Durability::None);
+     fullCheckpointDue = false;
+ }
+
+ // Apply one delta log record on top of the loaded book
+ void applyDelta(const json& record)
+ {
+     string accNum = record["accountNumber"];
+     if (record.value("removed", false)) {
+         eraseAccount(accNum);
+         return;
+     }
+
+     PersonalInfo info = infoFromJson(record["customerInfo"]);
+     B bal = record["balance"].get<B>();
+     uint32_t row;
+     if (uint32_t* existing = accountIndex.find(accNum)) {
+         row = *existing;
+         store.get(row)->setBalance(bal);
+         store.get(row)->setCustomerInfo(info);
+     } else {
+         row = makeAccount(accNum, bal, record["type"], info);
+         if (row == noAccountRow) return;
+         store.get(row)->setCustomerInfo(info);
+     }
+     store.accrualDayAt(row) = parseAccrualDay(record.value("lastAccrual", ""));
+ }
+
+ // JSON image of the account in a row with the balance the caller read, shared by
+ // accounts.json and the delta log
+ json accountToJson(uint32_t row, B balance)
+ {
+     BankAccount<B>* acc = store.get(row);
+     PersonalInfo info = acc->getCustomerInfo();
+     json j = {
+         {"accountNumber", acc->getAccountNumber()},
+         {"balance", balance},
+         {"type", acc->accountType()},
+         {"customerInfo", {
+             {"name", info.name},
+             {"dob", info.dob},
+             {"cnic", info.cnic},
+             {"address", info.address},
+             {"openingDate", info.getFormattedOpeningDate()}  // Store as formatted string
+         }}
+     };
+     // Written with the balance it belongs to, so a credited image is never replayed twice
+     if (int32_t day = store.accrualDayAt(row)) j["lastAccrual"] = formatAccrualDay(day);
+     return j;
+ }
+
+ // Opening dates are stored as "%Y-%m-%d %H:%M:%S" local time
+ static time_t parseOpeningDate(const string& dateStr)
+ {
+     struct tm tm = {};
+     strptime(dateStr.c_str(), "%Y-%m-%d %H:%M:%S", &tm);
+     return mktime(&tm);
+ }
+
+ static size_t fileSizeOf(const string& path)
+ {
+     ifstream file(path, ios::binary | ios::ate);
+     return file.is_open() ? static_cast<size_t>(file.tellg()) : 0;
+ }
+
+ static PersonalInfo infoFromJson(const json& item)
+ {
+     PersonalInfo info;
+     info.name = item["name"];
+     info.dob = item["dob"];
+     info.cnic = item["cnic"];
+     info.address = item["address"];
+
+     // Handle both string and number formats for openingDate
+     if (item["openingDate"].is_string()) {
+         info.openingDate = parseOpeningDate(item["openingDate"]);
+     } else if (item["openingDate"].is_number()) {
+         // Directly use number (Unix timestamp)
+         info.openingDate = item["openingDate"];
+     } else {
+         // Fallback to current time
+         info.openingDate = time(nullptr);
+     }
+     return info;
+ }
+
+ // Snapshot entry of the account in a row with the balance the caller read
+ SnapshotEntry snapshotEntry(uint32_t row, B balance, uint8_t type)
+ {
+     BankAccount<B>* acc = store.get(row);
+     PersonalInfo info = acc->getCustomerInfo();
+     SnapshotEntry entry;
+     entry.accountNumber = acc->getAccountNumber();
+     entry.balance = toMoney(balance).minorUnits();
+     entry.openingDate = static_cast<int64_t>(info.openingDate);
+     entry.type = type;
+     entry.accrualDay = store.accrualDayAt(row);
+     entry.fields[SnapshotName] = info.name;
+     entry.fields[SnapshotDob] = info.dob;
+     entry.fields[SnapshotCnic] = info.cnic;
+     entry.fields[SnapshotAddress] = info.address;
+     return entry;
+ }
+
+ // Snapshot entry of every account; the caller holds every stripe lock
+ vector<SnapshotEntry> snapshotEntries()
+ {
+     vector<SnapshotEntry> entries;
+     entries.reserve(store.size());
+     store.forEachHot([this, &entries](uint32_t row, BalanceCell<B>& balance, uint8_t type) {
+         entries.push_back(snapshotEntry(row, balance.load(), type));
+     });
+     return entries;
+ }
+
+ // Write the full image (JSON and snapshot) and empty the delta log. Balances are
+ // captured under every stripe lock, each read once for both files. As in
+ // writeDirtyBatch, an account's dirty mark is cleared before its balance is read, so
+ // a lock-free change that lands meanwhile either is in the image or marks the
+ // account dirty again and goes to the emptied log afterwards.
+ // The caller holds accountsMutex and persistMutex.
+ void writeAccountsFile()
+ {
+    try
+    {
+        json j = json::array();
+        vector<SnapshotEntry> entries;
+        {
+            auto stripeLocks = lockAllStripes();
+            for (auto& stripe : stripes) {
+                if (persistence.checkpointBytes) changedSinceCheckpoint.insert(stripe.dirty.begin(), stripe.dirty.end());
+                stripe.dirty.clear();
+            }
+            dirtyCount = 0;
+            entries.reserve(store.size());
+            store.forEachHot([this, &j, &entries](uint32_t row, BalanceCell<B>& balance, uint8_t type) {
+                store.flagsAt(row).fetch_and(static_cast<uint8_t>(~HotDirty));
+                B value = balance.load();
+                j.push_back(accountToJson(row, value));
+                entries.push_back(snapshotEntry(row, value, type));
+            });
+        }
+        bool syncNow = persistence.durability != Durability::None;
+        writeFileAtomically(filename, j.dump(4), syncNow);
+        AccountSnapshot::write(AccountSnapshot::pathFor(filename), entries, syncNow);
+
+        if (deltaLog) deltaLog->reset();
+        unsyncedChanges = false;
+    } catch (const exception& e) {
+        throw Exceptions::FileException(string("Error saving accounts: ") + e.what());
+    }
+ }
+
+ public:
+ // Save accounts to JSON file (full image; also empties the delta log)
+ // Exception handling for file operations
+ void saveAccountsToFile() {
+     shared_lock<shared_mutex> lock(accountsMutex);
+     lock_guard<mutex> persistLock(persistMutex);
+     writeAccountsFile();
+ }
+
+ // Load accounts from JSON file
+ void loadAccountsFromFile() {
+     loadAccountsFromFile(filename);
+ }
+
+ // Replace the in-memory book with the accounts stored in path (plus the committed
+ // changes in its delta log); path also becomes the file later saves go to. When the
+ // binary snapshot next to path is current it is used instead of parsing the JSON.
+ // Accounts are ingested in a single pass without writing anything back, so loading
+ // N accounts is O(N).
+ void loadAccountsFromFile(const string& path) {
+     unique_lock<shared_mutex> lock(accountsMutex);
+     lock_guard<mutex> persistLock(persistMutex);
+     if (!loadAccountsFromSnapshot(AccountSnapshot::pathFor(path), path)) {
+         clearAccounts();
+         size_t expected = fileSizeOf(path) / 256;   // pretty-printed records are larger
+         accountIndex.reserve(expected);
+
+         // Build each account from the token stream, no json DOM
+         PersonalInfo info;
+         string accNum, type;
+         B bal = B();
+         int32_t accrualDay = 0;
+         SaxRecordReader reader(
+             [&](const string& field, const SaxValue& value) {
+                 if (field == "accountNumber") accNum = value.text;
+                 else if (field == "balance") {
+                     // Decimal text, or the literal of a number in an older file, read exactly
+                     bal = value.kind == SaxValue::Integer ? AmountTraits<B>::fromDouble(value.asDouble())
+                                                           : AmountTraits<B>::parse(value.text);
+                 }
+                 else if (field == "type") type = value.text;
+                 else if (field == "lastAccrual") accrualDay = parseAccrualDay(value.text);
+                 else if (field == "customerInfo.name") info.name = value.text;
+                 else if (field == "customerInfo.dob") info.dob = value.text;
+                 else if (field == "customerInfo.cnic") info.cnic = value.text;
+                 else if (field == "customerInfo.address") info.address = value.text;
+                 else if (field == "customerInfo.openingDate") {
+                     info.openingDate = value.kind == SaxValue::String ? parseOpeningDate(value.text)
+                                      : value.isNumber() ? static_cast<time_t>(value.asDouble())
+                                      : time(nullptr);
+                 }
+             },
+             [&]() {
+                 uint32_t row = makeAccount(accNum, bal, type, info);
+                 if (row != noAccountRow) {
+                     store.get(row)->setCustomerInfo(info);   // keep the stored opening date
+                     store.accrualDayAt(row) = accrualDay;
+                 }
+                 info = PersonalInfo();
+                 info.openingDate = time(nullptr);
+                 accNum.clear(); type.clear();
+                 bal = B();
+                 accrualDay = 0;
+             });
+         info.openingDate = time(nullptr);
+         reader.parseFile(path);
+     }
+
+     deltaLog.reset();
+     filename = path;
+     deltaLog.reset(new DeltaLog(DeltaLog::pathFor(path),
+                                 [this](const json& record) { applyDelta(record); }));
+ }
+
+ // Write the binary snapshot of the book (JSON stays the import/export format)
+ void saveSnapshot(const string& snapPath, bool syncNow)
+ {
+     vector<SnapshotEntry> entries;
+     {
+         shared_lock<shared_mutex> lock(accountsMutex);
+         auto stripeLocks = lockAllStripes();
+         entries = snapshotEntries();
+     }
+     AccountSnapshot::write(snapPath, entries, syncNow);
+ }
+
+ private:
+ // Build the book straight from the fixed-width records of a mapped snapshot. Only
+ // the hot fields are read; PersonalInfo stays in the mapping until it is first used.
+ // Returns false (leaving the book untouched) when the snapshot is missing, invalid
+ // or older than the JSON file it belongs to.
+ bool loadAccountsFromSnapshot(const string& snapPath, const string& basePath)
+ {
+     shared_ptr<AccountSnapshot> snapshot = make_shared<AccountSnapshot>();
+     if (!AccountSnapshot::isCurrent(snapPath, basePath) || !snapshot->open(snapPath)) {
+         return false;
+     }
+
+     clearAccounts();
+     accountIndex.reserve(snapshot->size());
+     store.customers().attachSnapshot(snapshot);
+     PersonalInfo empty;
+     for (size_t i = 0; i < snapshot->size(); i++) {
+         const SnapshotRecord& rec = snapshot->record(i);
+         uint32_t row = makeAccount(string(snapshot->accountNumber(i)),
+                                    fromMoney(Money::fromMinor(rec.balance)),
+                                    rec.type == HotBusiness ? "Business" : "Saving", empty);
+         if (row != noAccountRow) {
+             store.customers().setLazy(row, static_cast<int64_t>(i));
+             store.accrualDayAt(row) = rec.accrualDay;
+         }
+     }
+     return true;
+ }
+
+ // Employee file writer; the caller holds employeesMutex
+ void writeEmployeesFile()
+ {
+     json j;
+     for (const auto& emp : employees) {
+         j.push_back({
+             {"employeeID", emp.getEmployeeID()},
+             {"name", emp.getName()},
+             {"designation", emp.getDesignation()},
+             {"salary", emp.getSalary()},
+             {"accountNumber", emp.getAccountNumber()}
+         });
+     }
+
+     ofstream file(employeesFile);
+     file << j.dump(4);
+     file.close();
+ }
+
+ // User file writer; the caller holds usersMutex
+ void writeUsersFile()
+ {
+    json j;
+    for (const auto& pair : users) {
+        j.push_back({
+            {"username", pair.second.getUsername()},
+            {"password", pair.second.password}, // Note: In real system, store hashed passwords
+            {"role", pair.second.getRole()},
+            {"associatedAccount", pair.second.getAssociatedAccount()}
+        });
+    }
+    ofstream file(usersFile);
+    file << j.dump(4);
+    file.close();
+ }
+
+ public:
+ // Function to add new employee
+ void addEmployee(const BankMember& employee)
+ {
+     lock_guard<mutex> lock(employeesMutex);
+     employees.push_back(employee);
+     writeEmployeesFile();
+ }
+
+ // Find an Employee
+ BankMember* findEmployee(const string& employeeID)
+ {
+     lock_guard<mutex> lock(employeesMutex);
+     for (auto& emp : employees)
+     {
+         if (emp.getEmployeeID() == employeeID)
+         {
+             return &emp;
+         }
+     }
+     return nullptr;
+ }
+
+ // Pay salary to employees
+ void payEmployeeSalary(const string& employeeID)
+ {
+     unique_ptr<BankMember> payee;    // copied so no lock is held while paying
+     {
+         lock_guard<mutex> lock(employeesMutex);
+         for (auto& emp : employees) {
+             if (emp.getEmployeeID() == employeeID) {
+                 payee.reset(new BankMember(emp));
+                 break;
+             }
+         }
+     }
+     if (payee) {
+         payee->paySalary<B>(this);  // Explicitly specify template parameter
+         return;
+     }
+     cout << "Employee not found!\n";
+ }
+
+ // Pay every employee (or those the filter accepts) in one run. Salaries are summed per
+ // destination account, the account credits are applied by worker threads that each
+ // own a subset of the stripes, every salary is journaled as a transaction, and the
+ // changed accounts are persisted in a single batch. Employees listed more than once
+ // are paid once. threads = 0 picks one per hardware thread.
+ PayrollReport<B> runPayroll(const function<bool(const BankMember&)>& filter = nullptr, size_t threads = 0)
+ {
+     auto start = chrono::steady_clock::now();
+     PayrollReport<B> report;
+
+     vector<BankMember> payees;
+     {
+         lock_guard<mutex> lock(employeesMutex);
+         unordered_set<string> seen;
+         for (const auto& emp : employees) {
+             if (filter && !filter(emp)) continue;
+             if (!seen.insert(emp.getEmployeeID()).second) {
+                 report.duplicates++;
+                 continue;
+             }
+             payees.push_back(emp);
+         }
+     }
+     report.employees = payees.size();
+
+     // Group salaries by destination account
+     struct Group
+     {
+         uint32_t row;
+         vector<const BankMember*> members;
+         B amount;
+     };
+     vector<Group> groups;                      // same order as report.credits
+     unordered_map<string, size_t> groupOf;
+
+     shared_lock<shared_mutex> lock(accountsMutex);
+     for (const auto& emp : payees) {
+         if (emp.getSalary() <= 0) {
+             report.failures.push_back(emp.getEmployeeID() + ": salary is not positive");
+             continue;
+         }
+         uint32_t* row = accountIndex.find(emp.getAccountNumber());
+         if (!row) {
+             report.failures.push_back(emp.getEmployeeID() + ": account " + emp.getAccountNumber() + " not found");
+             continue;
+         }
+         auto found = groupOf.find(emp.getAccountNumber());
+         if (found == groupOf.end()) {
+             found = groupOf.emplace(emp.getAccountNumber(), groups.size()).first;
+             groups.push_back(Group{*row, {}, B()});
+             report.credits.push_back(typename PayrollReport<B>::Credit());
+             report.credits.back().accountNumber = emp.getAccountNumber();
+         }
+         Group& group = groups[found->second];
+         group.members.push_back(&emp);
+         group.amount += AmountTraits<B>::fromDouble(emp.getSalary());
+     }
+
+     // Shard the groups by stripe; worker t applies stripes t, t + threads, ...
+     array<vector<size_t>, stripeCount> byStripe;
+     for (size_t g = 0; g < groups.size(); g++) byStripe[groups[g].row % stripeCount].push_back(g);
+     if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+     threads = max<size_t>(1, min(threads, groups.size()));
+     report.threads = threads;
+
+     vector<vector<string>> failures(threads);
+     vector<uint8_t> applied(groups.size(), 0);
+     auto work = [&](size_t t) {
+         JournalQueue& journal = JournalQueue::shared(transactionsFile);
+         for (size_t s = t; s < stripeCount; s += threads) {
+             if (byStripe[s].empty()) continue;
+             lock_guard<mutex> stripeLock(stripes[s].lock);
+             for (size_t g : byStripe[s]) {
+                 Group& group = groups[g];
+                 BankAccount<B>* acc = store.get(group.row);
+                 try {
+                     store.balanceAt(group.row).add(group.amount);
+                 } catch (const exception& e) {
+                     for (const BankMember* emp : group.members) {
+                         failures[t].push_back(emp->getEmployeeID() + ": " + e.what());
+                     }
+                     continue;
+                 }
+                 applied[g] = 1;
+                 for (const BankMember* emp : group.members) {
+                     JournalRecord record;
+                     record.fromAccount = "Bank";
+                     record.toAccount = acc->getAccountNumber();
+                     record.amount = AmountTraits<B>::toDouble(AmountTraits<B>::fromDouble(emp->getSalary()));
+                     record.status = "Completed";
+                     record.transactionType = "Salary";
+                     record.date = static_cast<int64_t>(time(nullptr));
+                     journal.enqueue(move(record));
+                 }
+                 markDirtyLocked(group.row, acc->getAccountNumber());
+             }
+         }
+     };
+     vector<thread> workers;
+     for (size_t t = 1; t < threads; t++) workers.emplace_back(work, t);
+     work(0);
+     for (auto& worker : workers) worker.join();
+
+     for (size_t g = 0; g < groups.size(); g++) {
+         if (!applied[g]) continue;
+         report.credits[g].employees = groups[g].members.size();
+         report.credits[g].amount = groups[g].amount;
+         report.paid += groups[g].members.size();
+         report.totalPaid += groups[g].amount;
+     }
+     report.credits.erase(remove_if(report.credits.begin(), report.credits.end(),
+                                    [](const typename PayrollReport<B>::Credit& c) { return c.employees == 0; }),
+                          report.credits.end());
+     for (auto& list : failures) report.failures.insert(report.failures.end(), list.begin(), list.end());
+
+     if (report.paid > 0) {
+         lock_guard<mutex> persistLock(persistMutex);
+         writeDirtyBatch(persistence.durability != Durability::None);
+         JournalQueue::shared(transactionsFile).flush();
+     }
+     report.elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+     return report;
+ }
 
+ // Save Employee data to file
+ void saveEmployeesToFile() {
+     lock_guard<mutex> lock(employeesMutex);
+     writeEmployeesFile();
+ }
 
-// -----------------------------------------Bank class(Singleton)-----------------------------
-template<typename B>
-class Bank
-{
-private:
- static Bank* instance;
- vector<BankAccount<B>*> accounts;
- map<string, BankAccount<B>*> accountMap;  // Using map for fast access
- string filename = "accounts.json";         // json file to store accounts data
- vector<BankMember> employees;
- string employeesFile = "employees.json";   // json file to store Employee data
- map<string, User> users;                // username -> User
- string usersFile = "users.json";                // json file to store user data
- 
- // Private constructor
- Bank()
+ // Load employee from file
+ void loadEmployeesFromFile()
  {
-    // Exception handling for file loading
-    // Load accounts, employees, and users from files
-    try {
-        loadAccountsFromFile();
-        loadEmployeesFromFile();
-        loadUsersFromFile();
-    } catch (const Exceptions::FileException& e) {
-        cerr << "Initialization error: " << e.what() << endl;
-    }
-}
- 
-public:
- // Static function to get instance
- static Bank* getInstance()
+     lock_guard<mutex> lock(employeesMutex);
+     // Build each BankMember from the token stream, no json DOM
+     string id, name, designation, accountNumber;
+     double salary = 0.0;
+     SaxRecordReader reader(
+         [&](const string& path, const SaxValue& value) {
+             if (path == "employeeID") id = value.text;
+             else if (path == "name") name = value.text;
+             else if (path == "designation") designation = value.text;
+             else if (path == "salary") salary = value.asDouble();
+             else if (path == "accountNumber") accountNumber = value.text;
+         },
+         [&]() {
+             employees.push_back(BankMember(id, name, designation, salary, accountNumber));
+             id.clear(); name.clear(); designation.clear(); accountNumber.clear();
+             salary = 0.0;
+         });
+     reader.parseFile(employeesFile);
+ }
+
+ // Function to deduct zakat from saving account
+ void processZakat(const string& accNum)
  {
-     if (!instance)
-     {
-         instance = new Bank();
+     shared_lock<shared_mutex> lock(accountsMutex);
+     uint32_t* row = accountIndex.find(accNum);
+     if (row && store.typeAt(*row) == HotSaving) {
+         SavingAccount<B>* savingAcc = static_cast<SavingAccount<B>*>(store.get(*row));
+         {
+             Stripe& stripe = stripeFor(*row);
+             lock_guard<mutex> guard(stripe.lock);
+             savingAcc->calculateZakat();
+             markDirtyLocked(*row, accNum);
+         }
+         maybeFlush();
+     } else {
+         cout << "Account not found or not a Saving account\n";
      }
-     return instance;
  }
- 
- // Destructor to clean up dynamically allocated accounts
- ~Bank()
+
+ // Apply deposits, withdrawals and transfers in order under one lock round: the stripe
+ // locks are taken once for the whole batch, every applied record is journaled through
+ // the JournalQueue, and the changed accounts go out with the normal delta batches.
+ // errors[i] is left empty when ops[i] was applied. Returns the number applied.
+ size_t applyBatch(const vector<BatchOp<B>>& ops, vector<string>& errors)
  {
-     for (auto* acc : accounts)
+     size_t applied = applyBatchUnflushed(ops, errors);
      {
-         delete acc;
+         shared_lock<shared_mutex> lock(accountsMutex);
+         maybeFlush();
      }
- }
- // Function to get account
- const vector<BankAccount<B>*>& getAccounts() const { return accounts; }
- const map<string, User>& getUsers() const { return users; }
- // Add account with map
- void addAccount(BankAccount<B>* acc)
- {
-     accounts.push_back(acc);
-     accountMap[acc->getAccountNumber()] = acc;
-     saveAccountsToFile();
+     deferredWork();
+     return applied;
  }
 
- // Find account using map
- BankAccount<B>* findAccount(const string& accNum)
+ // Stream a CSV or JSONL file of transactions (see batch_file.h) through the batch path
+ // a few thousand records at a time, writing "line,status,message" for every record to
+ // reportPath. Account images are flushed once per window of records rather than once
+ // per batch, since a busy account would otherwise be rewritten for every batch. Ends
+ // with the accounts flushed and the journal durable.
+ BatchSummary applyBatchFile(const string& path, const string& reportPath)
  {
-     auto it = accountMap.find(accNum);
-     return (it != accountMap.end()) ? it->second : nullptr;
+     const size_t batchRecords = 4096;
+     const size_t flushEveryRecords = 64 * batchRecords;
+     auto start = chrono::steady_clock::now();
+     BatchSummary summary;
+
+     BatchFileReader reader(path);
+     vector<char> reportBuffer(1 << 16);
+     ofstream report;
+     report.rdbuf()->pubsetbuf(reportBuffer.data(), reportBuffer.size());
+     report.open(reportPath, ios::binary | ios::trunc);
+     if (!report.is_open()) {
+         throw Exceptions::FileException("Cannot write batch report: " + reportPath);
+     }
+     report << "line,status,message\n";
+
+     vector<BatchRecord> records(batchRecords);
+     vector<BatchOp<B>> ops;
+     vector<size_t> opRecord;                // op -> index in records
+     vector<string> errors;
+     bool more = true;
+     while (more) {
+         size_t count = 0;
+         while (count < batchRecords && (more = reader.next(records[count]))) count++;
+
+         ops.clear();
+         opRecord.clear();
+         for (size_t i = 0; i < count; i++) {
+             BatchRecord& rec = records[i];
+             if (!rec.error.empty()) continue;
+             BatchOp<B> op;
+             try {
+                 op.amount = AmountTraits<B>::parse(rec.amount);
+             } catch (const exception&) {
+                 rec.error = "Invalid amount: " + rec.amount;
+                 continue;
+             }
+             if (rec.type == BatchOpType::Transfer && rec.toAccount.empty()) {
+                 rec.error = "Transfer needs a toAccount";
+                 continue;
+             }
+             op.type = rec.type;
+             op.account = move(rec.account);
+             op.toAccount = move(rec.toAccount);
+             ops.push_back(move(op));
+             opRecord.push_back(i);
+         }
+         summary.applied += applyBatchUnflushed(ops, errors);
+         for (size_t k = 0; k < ops.size(); k++) records[opRecord[k]].error = move(errors[k]);
+
+         for (size_t i = 0; i < count; i++) {
+             const BatchRecord& rec = records[i];
+             if (rec.error.empty()) {
+                 report << rec.line << ",ok,\n";
+             } else {
+                 report << rec.line << ",failed," << quoteCsv(rec.error) << "\n";
+                 summary.failed++;
+             }
+         }
+         summary.records += count;
+         if (summary.records % flushEveryRecords == 0) flush();
+     }
+
+     flush();
+     JournalQueue::shared(transactionsFile).flush();
+     report.close();
+     if (!report) {
+         throw Exceptions::FileException("Error writing batch report: " + reportPath);
+     }
+     summary.elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+     return summary;
  }
 
- // Remove account
- void removeAccount(const string& accNum)
+ // Annual zakat for the whole book in one pass over the hot columns: 2.5% of every
+ // saving balance at or above the nisab. Each deduction is journaled and the changed
+ // accounts are persisted in a single batch at the end. A dry run changes nothing and
+ // only reports what would be deducted.
+ ZakatReport<B> runZakatCycle(bool dryRun = false)
  {
-     auto it = accountMap.find(accNum);
-     if (it != accountMap.end())
+     auto start = chrono::steady_clock::now();
+     ZakatReport<B> report;
+     report.dryRun = dryRun;
+     uint64_t lastSequence = 0;
+
+     shared_lock<shared_mutex> lock(accountsMutex);
      {
-         delete it->second;
-         accountMap.erase(it);
-         
-         // Remove from vector
-         accounts.erase(
-             remove_if(accounts.begin(), accounts.end(),
-                 [accNum](BankAccount<B>* acc) { 
-                     return acc->getAccountNumber() == accNum; 
-                 }),
-                 accounts.end());
-                 
-                 saveAccountsToFile();
+         auto stripeLocks = lockAllStripes();
+         vector<B> balances;
+         vector<uint8_t> saving;
+         vector<B> due;
+         store.forEachHotChunk([&](HotSpan<B>& span) {
+             balances.resize(span.count);
+             saving.resize(span.count);
+             due.resize(span.count);
+             for (uint32_t i = 0; i < span.count; i++) {
+                 balances[i] = span.balances[i].load();
+                 saving[i] = (span.flags[i].load() & HotLive) && span.types[i] == HotSaving;
              }
-         }
-         
-         // Create account (factory method)
-         BankAccount<B>* createAccount(const string& accNum, B balance, const string& type, PersonalInfo info)
-         {
-             BankAccount<B>* acc = nullptr;
-                // Exception handling for account creation
-             if (accNum.empty()) {
-                throw Exceptions::AccountException("Account number cannot be empty");
-            }
-            // Check if account number already exists
-            if (balance < 0) {
-                throw Exceptions::AccountException("Initial balance cannot be negative");
-            }
-            // Check if account already exists
+             zakatKernel(balances.data(), saving.data(), due.data(), span.count);
 
-             if (type == "Saving")
-             {
-                 acc = new SavingAccount<B>(accNum, balance, info, 0.0, 0, true);
+             for (uint32_t i = 0; i < span.count; i++) {
+                 if (!saving[i]) continue;
+                 report.savingAccounts++;
+                 if (due[i] == B()) {
+                     report.belowNisab++;
+                     continue;
+                 }
+                 uint32_t row = span.firstRow + i;
+                 SavingAccount<B>* acc = static_cast<SavingAccount<B>*>(store.get(row));
+                 if (!dryRun) {
+                     // Deposits and withdrawals do not wait for the stripe locks
+                     if (!span.balances[i].tryWithdraw(due[i])) {
+                         report.skipped++;
+                         continue;
+                     }
+                     acc->setZakat(due[i]);
+                     JournalRecord record;
+                     record.fromAccount = acc->getAccountNumber();
+                     record.toAccount = "Bank";
+                     record.amount = AmountTraits<B>::toDouble(due[i]);
+                     record.status = "Completed";
+                     record.transactionType = "Zakat";
+                     record.date = static_cast<int64_t>(time(nullptr));
+                     lastSequence = JournalQueue::shared(transactionsFile).enqueue(move(record));
+                     markDirtyLocked(row, acc->getAccountNumber());
+                 }
+                 report.totalZakat += due[i];
+                 report.lines.push_back({acc->getAccountNumber(), balances[i], due[i]});
+             }
+         });
      }
-     else if (type == "Business")
+
+     if (!dryRun && !report.lines.empty()) {
+         lock_guard<mutex> persistLock(persistMutex);
+         writeDirtyBatch(persistence.durability != Durability::None);
+         JournalQueue::shared(transactionsFile).waitDurable(lastSequence);
+     }
+     report.elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+     return report;
+ }
+
+ private:
+ // Marker of an interest run in progress (accounts.json -> accounts.accrual)
+ string accrualMarkerPath() const
+ {
+     const string suffix = ".json";
+     if (filename.size() > suffix.size() &&
+         filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) == 0) {
+         return filename.substr(0, filename.size() - suffix.size()) + ".accrual";
+     }
+     return filename + ".accrual";
+ }
+
+ // Finish an interest run that stopped after its journal records were durable but
+ // before the images they belong to were written: every Interest record journaled
+ // after the run's marker is credited to its account, unless the account's image
+ // already has the day. Removes the marker. The caller holds accountsMutex.
+ size_t recoverInterestAccrual(JournalQueue& journal)
+ {
+     const string markerPath = accrualMarkerPath();
+     int32_t day = 0;
+     uint64_t journalOffset = 0;
      {
-         acc = new BusinessAccount<B>(accNum, balance, info, "LinkedSystem");
+         ifstream marker(markerPath);
+         if (!(marker >> day >> journalOffset)) return 0;
      }
-     else
+     journal.flush();
+
+     size_t recovered = 0;
      {
-         cout << "Invalid account type!" << endl;
-         return nullptr;
+         auto stripeLocks = lockAllStripes();
+         TransactionJournal::forEach(transactionsFile, [&](const JournalRecord& record, uint64_t) {
+             if (record.transactionType != "Interest" || record.fromAccount != "Bank") return true;
+             uint32_t* row = accountIndex.find(record.toAccount);
+             if (!row || store.accrualDayAt(*row) >= day) return true;
+             store.balanceAt(*row).add(AmountTraits<B>::fromDouble(record.amount));
+             store.accrualDayAt(*row) = day;
+             markDirtyLocked(*row, record.toAccount);
+             recovered++;
+             return true;
+         }, journalOffset);
      }
-     // Add account to map and vector
-     if (acc) addAccount(acc);
-     return acc;
+     if (recovered > 0) {
+         lock_guard<mutex> persistLock(persistMutex);
+         writeDirtyBatch(persistence.durability != Durability::None);
+     }
+     remove(markerPath.c_str());
+     return recovered;
  }
- 
- // Save accounts to JSON file
- // Exception handling for file operations
- void saveAccountsToFile() {
-    try
-    {
-        json j;
-        for (auto* acc : accounts)
-        {
-         char buffer[80];
-         time_t openTime = acc->getCustomerInfo().openingDate;
-         strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", localtime(&openTime));
-         
-         j.push_back({
-             {"accountNumber", acc->getAccountNumber()},
-             {"balance", acc->getBalance()},
-             {"type", acc->accountType()},
-             {"customerInfo", {
-                 {"name", acc->getCustomerInfo().name},
-                 {"dob", acc->getCustomerInfo().dob},
-                 {"cnic", acc->getCustomerInfo().cnic},
-                 {"address", acc->getCustomerInfo().address},
-                 {"openingDate", buffer}  // Store as formatted string
-             }}
-         });
+
+ public:
+ // One day of interest for every saving account. Chunks of the hot columns are
+ // copied into plain arrays for accrueDailyInterest(), then the credits are applied,
+ // journaled and persisted window by window. Each credited account records the day
+ // in the same image as its new balance, so running the same day again credits only
+ // the accounts not yet done. A window's journal records are durable before any
+ // batch writes its images, so a run stops cleanly only between windows; a marker
+ // file (the day and the journal offset the run started at) stays behind while the
+ // run is going, and the next run first credits whatever that journal tail holds for
+ // accounts whose image missed it, rather than crediting them a second time. A dry
+ // run changes nothing and only reports the totals.
+ InterestReport<B> runInterestAccrual(const InterestSchedule<B>& schedule = InterestSchedule<B>::standard(),
+                                      int32_t day = 0, bool dryRun = false)
+ {
+     try {
+         schedule.validate();
+     } catch (const invalid_argument& e) {
+         throw Exceptions::TransactionException(string("Invalid interest schedule: ") + e.what());
      }
-     ofstream file(filename);
-     if (!file.is_open()) {
-         throw Exceptions::FileException("Failed to open accounts file for writing");
+     auto start = chrono::steady_clock::now();
+     InterestReport<B> report;
+     report.day = day > 0 ? day : accrualDayOf(time(nullptr));
+     report.dryRun = dryRun;
+     const uint32_t windowChunks = 64;
+
+     lock_guard<mutex> accrualLock(accrualMutex);
+     JournalQueue& journal = JournalQueue::shared(transactionsFile);
+     uint64_t lastSequence = 0;
+     size_t windowCredits = 0;
+     uint32_t chunksInWindow = 0;
+     vector<unique_lock<mutex>> stripeLocks;
+     vector<B> balances, due;
+     vector<uint8_t> eligible;
+
+     // A window holds persistMutex from its first chunk until its images are written, so
+     // no other batch (maybeFlush only tries the lock) can log a credited balance before
+     // the window's journal records are durable
+     unique_lock<mutex> persistLock(persistMutex, defer_lock);
+
+     // Release the stripes so traffic can proceed, then commit the window's images
+     auto closeWindow = [&]() {
+         stripeLocks.clear();
+         chunksInWindow = 0;
+         if (windowCredits > 0) {
+             journal.waitDurable(lastSequence);
+             writeDirtyBatch(persistence.durability != Durability::None);
+             report.windows++;
+             windowCredits = 0;
+         }
+         if (persistLock.owns_lock()) persistLock.unlock();
+     };
+
+     shared_lock<shared_mutex> lock(accountsMutex);
+     if (!dryRun) {
+         report.recovered = recoverInterestAccrual(journal);
+         writeFileAtomically(accrualMarkerPath(), to_string(report.day) + " "
+                             + to_string(TransactionJournal::shared(transactionsFile).size()) + "\n", true);
      }
-     file << j.dump(4);
-     file.close();
- } catch (const exception& e) {
-     throw Exceptions::FileException(string("Error saving accounts: ") + e.what());
+     store.forEachHotChunk([&](HotSpan<B>& span) {
+         if (stripeLocks.empty()) {
+             if (!dryRun) persistLock.lock();
+             stripeLocks = lockAllStripes();
+         }
+         balances.resize(span.count);
+         due.resize(span.count);
+         eligible.resize(span.count);
+         for (uint32_t i = 0; i < span.count; i++) {
+             bool saving = (span.flags[i].load() & HotLive) && span.types[i] == HotSaving;
+             bool done = span.accrualDays[i] >= report.day;
+             report.savingAccounts += saving;
+             report.alreadyAccrued += saving && done;
+             balances[i] = span.balances[i].load();
+             eligible[i] = saving && !done;
+         }
+         accrueDailyInterest(balances.data(), eligible.data(), due.data(), span.count, schedule);
+
+         for (uint32_t i = 0; i < span.count; i++) {
+             if (!eligible[i]) continue;
+             if (due[i] <= B()) {
+                 report.noInterest++;
+                 continue;
+             }
+             report.credited++;
+             report.totalInterest += due[i];
+             if (dryRun) continue;
+
+             uint32_t row = span.firstRow + i;
+             const string& accNum = store.get(row)->getAccountNumber();
+             span.balances[i].add(due[i]);
+             span.accrualDays[i] = report.day;
+             JournalRecord record;
+             record.fromAccount = "Bank";
+             record.toAccount = accNum;
+             record.amount = AmountTraits<B>::toDouble(due[i]);
+             record.status = "Completed";
+             record.transactionType = "Interest";
+             record.date = static_cast<int64_t>(time(nullptr));
+             lastSequence = journal.enqueue(move(record));
+             markDirtyLocked(row, accNum);
+             windowCredits++;
+         }
+         if (++chunksInWindow == windowChunks) closeWindow();
+     });
+     closeWindow();
+     if (!dryRun) remove(accrualMarkerPath().c_str());
+
+     report.elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+     return report;
  }
-}
- 
- // Load accounts from JSON file
- void loadAccountsFromFile() {
-     ifstream file(filename);
-     if (!file.is_open()) return;
- 
-     json j;
-     file >> j;
-     file.close();
- 
-     for (auto& item : j) {
-         PersonalInfo info;
-         info.name = item["customerInfo"]["name"];
-         info.dob = item["customerInfo"]["dob"];
-         info.cnic = item["customerInfo"]["cnic"];
-         info.address = item["customerInfo"]["address"];
- 
-         // Handle both string and number formats for openingDate
-         if (item["customerInfo"]["openingDate"].is_string()) {
-             // Parse string format
-             struct tm tm = {};
-             string dateStr = item["customerInfo"]["openingDate"];
-             strptime(dateStr.c_str(), "%Y-%m-%d %H:%M:%S", &tm);
-             info.openingDate = mktime(&tm);
-         } else if (item["customerInfo"]["openingDate"].is_number()) {
-             // Directly use number (Unix timestamp)
-             info.openingDate = item["customerInfo"]["openingDate"];
+
+ // End-of-day settlement of a batch of pending transfers (payouts and the like): one
+ // hash pass sums every account's net position, then only the net changes are applied,
+ // one balance change and one "Settlement" journal record per account that moves,
+ // instead of two per transfer. The batch settles completely or not at all. It is
+ // refused when a record is not a valid transfer, when an account would go negative
+ // after netting, or when a saving account that may not withdraw ends up a net payer;
+ // report.violations then lists every reason and no balance changes.
+ SettlementReport<B> settleNetted(const vector<BatchOp<B>>& transfers)
+ {
+     auto start = chrono::steady_clock::now();
+     SettlementReport<B> report;
+     report.transfers = transfers.size();
+
+     // Net position per account
+     unordered_map<string, size_t> positionOf;
+     positionOf.reserve(transfers.size() / 4 + 16);
+     auto position = [&](const string& accNum) -> typename SettlementReport<B>::Position& {
+         auto it = positionOf.emplace(accNum, report.positions.size());
+         if (it.second) report.positions.push_back({accNum, B(), 0});
+         return report.positions[it.first->second];
+     };
+     for (size_t i = 0; i < transfers.size(); i++) {
+         const BatchOp<B>& op = transfers[i];
+         string where = "Transfer " + to_string(i + 1) + ": ";
+         if (op.type != BatchOpType::Transfer) {
+             report.violations.push_back(where + "only transfers can be netted");
+         } else if (op.amount <= B()) {
+             report.violations.push_back(where + "amount must be positive");
+         } else if (op.account == op.toAccount) {
+             report.violations.push_back(where + "cannot transfer to the same account");
          } else {
-             // Fallback to current time
-             info.openingDate = time(nullptr);
+             try {
+                 auto& from = position(op.account);
+                 from.net -= op.amount;
+                 from.legs++;
+                 auto& to = position(op.toAccount);
+                 to.net += op.amount;
+                 to.legs++;
+                 report.grossVolume += op.amount;
+             } catch (const exception& e) {
+                 report.violations.push_back(where + e.what());
+             }
          }
-         
-         string accNum = item["accountNumber"];
-         B bal = item["balance"];
-         string type = item["type"];
-         
-         createAccount(accNum, bal, type, info);
      }
+
+     JournalQueue& journal = JournalQueue::shared(transactionsFile);
+     uint64_t lastSequence = 0;
+     shared_lock<shared_mutex> lock(accountsMutex);
+     vector<uint32_t> rows(report.positions.size());
+     vector<bool> stripeUsed(stripeCount, false);
+     for (size_t k = 0; k < report.positions.size() && report.violations.empty(); k++) {
+         uint32_t* row = accountIndex.find(report.positions[k].accountNumber);
+         if (!row) {
+             report.violations.push_back("Account not found: " + report.positions[k].accountNumber);
+             continue;
+         }
+         rows[k] = *row;
+         stripeUsed[*row % stripeCount] = true;
+     }
+
+     if (report.violations.empty()) {
+         // Only the stripes of the accounts involved, in ascending order
+         vector<unique_lock<mutex>> stripeLocks;
+         for (size_t s = 0; s < stripeCount; s++) {
+             if (stripeUsed[s]) stripeLocks.emplace_back(stripes[s].lock);
+         }
+
+         for (size_t k = 0; k < report.positions.size(); k++) {
+             const auto& p = report.positions[k];
+             if (!(p.net < B())) continue;
+             if (store.typeAt(rows[k]) == HotSaving
+                 && !static_cast<SavingAccount<B>*>(store.get(rows[k]))->getCanWithdraw()) {
+                 report.violations.push_back("Withdrawals not allowed for account " + p.accountNumber);
+             } else if (store.balanceAt(rows[k]).load() + p.net < B()) {
+                 ostringstream shortfall;
+                 shortfall << -(store.balanceAt(rows[k]).load() + p.net);
+                 report.violations.push_back("Account " + p.accountNumber + " would be overdrawn by " + shortfall.str());
+             }
+         }
+
+         // Debits first: deposits and withdrawals elsewhere do not take the stripe
+         // locks, so a debit can still fail here; the applied ones are then put back
+         vector<size_t> debited;
+         for (size_t k = 0; k < report.positions.size() && report.violations.empty(); k++) {
+             const auto& p = report.positions[k];
+             if (!(p.net < B())) continue;
+             if (!store.balanceAt(rows[k]).tryWithdraw(-p.net)) {
+                 for (size_t d : debited) store.balanceAt(rows[d]).add(-report.positions[d].net);
+                 report.violations.push_back("Insufficient balance in account " + p.accountNumber);
+                 break;
+             }
+             debited.push_back(k);
+         }
+
+         if (report.violations.empty()) {
+             int64_t now = static_cast<int64_t>(time(nullptr));
+             for (size_t k = 0; k < report.positions.size(); k++) {
+                 const auto& p = report.positions[k];
+                 if (p.net == B()) continue;
+                 JournalRecord record;
+                 if (p.net < B()) {
+                     record.fromAccount = p.accountNumber;
+                     record.toAccount = "Settlement";
+                     record.amount = AmountTraits<B>::toDouble(-p.net);
+                     report.netVolume += -p.net;
+                 } else {
+                     store.balanceAt(rows[k]).add(p.net);
+                     record.fromAccount = "Settlement";
+                     record.toAccount = p.accountNumber;
+                     record.amount = AmountTraits<B>::toDouble(p.net);
+                 }
+                 record.status = "Completed";
+                 record.transactionType = "Settlement";
+                 record.date = now;
+                 lastSequence = journal.enqueue(move(record));
+                 markDirtyLocked(rows[k], p.accountNumber);
+                 report.mutations++;
+             }
+             report.settled = true;
+         }
+     }
+
+     if (report.settled && report.mutations > 0) {
+         lock_guard<mutex> persistLock(persistMutex);
+         writeDirtyBatch(persistence.durability != Durability::None);
+         journal.waitDurable(lastSequence);
+     }
+     report.elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+     return report;
  }
- 
- // Function to add new employee
- void addEmployee(const BankMember& employee)
- {
-     employees.push_back(employee);
-     saveEmployeesToFile();
- }
- 
- // Find an Employee
- BankMember* findEmployee(const string& employeeID)
+
+ // settleNetted over a transfer file in the --apply-batch formats (batch_file.h); a
+ // line that does not parse refuses the batch like any other violation
+ SettlementReport<B> settleNettedFile(const string& path)
  {
-     for (auto& emp : employees)
-     {
-         if (emp.getEmployeeID() == employeeID)
-         {
-             return &emp;
+     BatchFileReader reader(path);
+     BatchRecord rec;
+     vector<BatchOp<B>> transfers;
+     vector<string> parseErrors;
+     while (reader.next(rec)) {
+         BatchOp<B> op;
+         if (rec.error.empty()) {
+             try {
+                 op.amount = AmountTraits<B>::parse(rec.amount);
+             } catch (const exception&) {
+                 rec.error = "Invalid amount: " + rec.amount;
+             }
          }
+         if (!rec.error.empty()) {
+             parseErrors.push_back("Line " + to_string(rec.line) + ": " + rec.error);
+             continue;
+         }
+         op.type = rec.type;
+         op.account = move(rec.account);
+         op.toAccount = move(rec.toAccount);
+         transfers.push_back(move(op));
      }
-     return nullptr;
+     if (!parseErrors.empty()) {
+         SettlementReport<B> report;
+         report.transfers = transfers.size() + parseErrors.size();
+         report.violations = move(parseErrors);
+         return report;
+     }
+     return settleNetted(transfers);
  }
- 
- // Pay salary to employees
- void payEmployeeSalary(const string& employeeID)
+
+ // Statements for [from, to] (inclusive) of the given accounts, or of every account
+ // when none are given, written as one file per account into outputDir (see
+ // statement.h). The balances are taken with accountsMutex held exclusively and the
+ // journal queue drained: every operation journals before it releases accountsMutex,
+ // so they belong to exactly the journal records the engine reads. Operations wait
+ // for the capture (not for the files).
+ StatementSummary generateStatements(time_t from, time_t to, const string& outputDir,
+                                     const vector<string>& accounts = {}, size_t threads = 0)
  {
-     for (auto& emp : employees) {
-         if (emp.getEmployeeID() == employeeID) {
-             emp.paySalary<B>(this);  // Explicitly specify template parameter
-             return;
+     if (to < from) {
+         throw Exceptions::TransactionException("Statement period ends before it starts");
+     }
+     StatementRequest request;
+     request.from = from;
+     request.to = to;
+     request.outputDir = outputDir;
+     request.threads = threads;
+     {
+         unique_lock<shared_mutex> lock(accountsMutex);
+         JournalQueue::shared(transactionsFile).flush();
+         request.journalEnd = TransactionJournal::shared(transactionsFile).size();
+         if (accounts.empty()) {
+             request.balances.reserve(store.size());
+             store.forEachHot([this, &request](uint32_t row, BalanceCell<B>& balance, uint8_t) {
+                 request.balances.emplace_back(store.get(row)->getAccountNumber(), toMoney(balance.load()));
+             });
+         }
+         for (const string& accNum : accounts) {
+             uint32_t* row = accountIndex.find(accNum);
+             if (!row) {
+                 throw Exceptions::AccountException("Account not found: " + accNum);
+             }
+             request.balances.emplace_back(accNum, toMoney(store.balanceAt(*row).load()));
          }
      }
-     cout << "Employee not found!\n";
+     return writeStatements(transactionsFile, request);
  }
- 
- // Save Employee data to file
- void saveEmployeesToFile() {
-     json j;
-     for (const auto& emp : employees) {
-         j.push_back({
-             {"employeeID", emp.getEmployeeID()},
-             {"name", emp.getName()},
-             {"designation", emp.getDesignation()},
-             {"salary", emp.getSalary()},
-             {"accountNumber", emp.getAccountNumber()}
+
+ // Rebuild every balance from the journal and write the accounts that disagree with
+ // the account table to reportPath as CSV (see reconcile.h). Like generateStatements,
+ // the table is captured with accountsMutex held exclusively and the journal queue
+ // drained, so a running bank reconciles against balances and records of the same
+ // moment.
+ ReconcileSummary reconcileBalances(const string& reportPath, size_t threads = 0, Money tolerance = Money())
+ {
+     ReconcileRequest request;
+     request.reportPath = reportPath;
+     request.threads = threads;
+     request.tolerance = tolerance;
+     {
+         unique_lock<shared_mutex> lock(accountsMutex);
+         JournalQueue::shared(transactionsFile).flush();
+         request.journalEnd = TransactionJournal::shared(transactionsFile).size();
+         request.balances.reserve(store.size());
+         store.forEachHot([this, &request](uint32_t row, BalanceCell<B>& balance, uint8_t) {
+             request.balances.emplace_back(store.get(row)->getAccountNumber(), toMoney(balance.load()));
          });
      }
-
-     ofstream file(employeesFile);
-     file << j.dump(4);
-     file.close();
+     return reconcileJournal(transactionsFile, request);
  }
- 
- // Load employee from file
- void loadEmployeesFromFile()
- {
-     ifstream file(employeesFile);
-     if (!file.is_open()) return;
 
-     json j;
-     file >> j;
-     file.close();
+ // Write a balance checkpoint now instead of waiting for checkpointBytes of journal;
+ // full lists every account
+ void checkpointBalances(bool full = false)
+ {
+     unique_lock<shared_mutex> lock(accountsMutex);
+     lock_guard<mutex> persistLock(persistMutex);
+     openCheckpointLog();
+     if (full) fullCheckpointDue = true;
+     writeCheckpoint();
+ }
 
-     for (auto& item : j)
+ // Balance an account had at a point in time: every journal record dated up to then
+ // counted, none after. Replays at most one checkpoint interval of the journal (see
+ // checkpoint.h) from the checkpoint nearest to that time, up to the last record the
+ // journal queue made durable, so the query holds accountsMutex shared and traffic
+ // goes on. Only when no checkpoint lists the account around that time (it was opened
+ // since the last one, or its number is too long for an entry) does it start from the
+ // live balance, which is read with accountsMutex held exclusively (no operation part
+ // way through) and the queue drained. Zero before the account was opened. Throws
+ // AccountException for an unknown account.
+ B balanceAsOf(const string& accNum, time_t when)
+ {
+     time_t opened;
+     CheckpointLog* log;
      {
-         BankMember emp(
-             item["employeeID"],
-             item["name"],
-             item["designation"],
-             item["salary"],
-             item["accountNumber"]
-         );
-         employees.push_back(emp);
+         shared_lock<shared_mutex> lock(accountsMutex);
+         uint32_t* row = accountIndex.find(accNum);
+         if (!row) {
+             throw Exceptions::AccountException("Account not found: " + accNum);
+         }
+         opened = store.get(*row)->getCustomerInfo().openingDate;
+         lock_guard<mutex> persistLock(persistMutex);
+         openCheckpointLog();
+         log = checkpointLog.get();
      }
- }
- 
- // Function to deduct zakat from saving account
- void processZakat(const string& accNum)
- {
-     BankAccount<B>* acc = findAccount(accNum);
-     if (acc && acc->accountType() == "Saving") {
-         SavingAccount<B>* savingAcc = dynamic_cast<SavingAccount<B>*>(acc);
-         if (savingAcc) {
-             savingAcc->calculateZakat();
-             saveAccountsToFile();
+     if (when < opened) return B();
+
+     HistoricalBalance past;
+     uint64_t durableEnd = JournalQueue::shared(transactionsFile).durableOffset();
+     if (!balanceFromCheckpoints(transactionsFile, *log, accNum, when, durableEnd, past)) {
+         Money live;
+         uint64_t journalEnd;
+         {
+             unique_lock<shared_mutex> lock(accountsMutex);
+             uint32_t* row = accountIndex.find(accNum);
+             if (!row) {
+                 throw Exceptions::AccountException("Account not found: " + accNum);
+             }
+             JournalQueue::shared(transactionsFile).flush();
+             journalEnd = TransactionJournal::shared(transactionsFile).size();
+             live = toMoney(store.balanceAt(*row).load());
          }
-     } else {
-         cout << "Account not found or not a Saving account\n";
+         past = Banking::balanceAsOf(transactionsFile, *log, accNum, when, live, journalEnd);
      }
+     return past.existed ? fromMoney(past.balance) : B();
  }
- 
+
  // Display account services (added function)
  void displayAccountServices(const string& accNum)
  {
@@ -536,67 +2236,58 @@ public:
          cout << "Account not found!\n";
      }
  }
- 
+
  // Deduct zakat (added function)
  void deductZakat(const string& accNum)
  {
      processZakat(accNum);
  }
- 
+
  void addUser(const User& user) {
+    lock_guard<mutex> lock(usersMutex);
     users[user.getUsername()] = user;
-    saveUsersToFile();
+    writeUsersFile();
  }
- 
+
  //  Find user
  User* authenticateUser(const string& username, const string& password) {
+    lock_guard<mutex> lock(usersMutex);
     auto it = users.find(username);
     if (it != users.end() && it->second.verifyPassword(password)) {
         return &(it->second);
     }
     return nullptr;
  }
- 
+
  // Save users to file
  void saveUsersToFile() {
-    json j;
-    for (const auto& pair : users) {
-        j.push_back({
-            {"username", pair.second.getUsername()},
-            {"password", pair.second.password}, // Note: In real system, store hashed passwords
-            {"role", pair.second.getRole()},
-            {"associatedAccount", pair.second.getAssociatedAccount()}
-        });
-    }
-    ofstream file(usersFile);
-    file << j.dump(4);
-    file.close();
+    lock_guard<mutex> lock(usersMutex);
+    writeUsersFile();
  }
- 
+
  // Load users from JSON file
  void loadUsersFromFile() {
-    ifstream file(usersFile);
-    if (!file.is_open()) return;
-
-    json j;
-    file >> j;
-    file.close();
-
-    for (auto& item : j) {
-        User user(
-            item["username"],
-            item["password"],
-            item["role"],
-            item.value("associatedAccount", "")
-        );
-        users[user.getUsername()] = user;
-    }
+    lock_guard<mutex> lock(usersMutex);
+    // Build each User from the token stream, no json DOM
+    User user;
+    SaxRecordReader reader(
+        [&](const string& path, const SaxValue& value) {
+            if (path == "username") user.username = value.text;
+            else if (path == "password") user.password = value.text;
+            else if (path == "role") user.role = value.text;
+            else if (path == "associatedAccount") user.associatedAccount = value.text;
+        },
+        [&]() {
+            users[user.getUsername()] = user;
+            user = User();
+        });
+    reader.parseFile(usersFile);
  }
 };
 
 //-------------------------------------- Saving Account----------------------------------
 template<typename B>
-class SavingAccount : public BankAccount<B>  // inherit from BankAccount class
+class SavingAccount final : public BankAccount<B>  // inherit from BankAccount class
 {
 private:
  B zakat;
@@ -629,11 +2320,12 @@ public:
  // Getters/Setters
  B getZakat() const;
  void setZakat(B zakat);
+ bool getCanWithdraw() const;
 };
 
 //------------------------------------- Business Account-----------------------------
 template<typename B>
-class BusinessAccount : public BankAccount<B>  // inherit from BankAccount class
+class BusinessAccount final : public BankAccount<B>  // inherit from BankAccount class
 {
 private:
  string LinkedManagementSystem;
@@ -699,6 +2391,7 @@ private:
 
 public:
  Transaction(string fromAcc, string toAcc, double amt, string stat, string type);
+ Transaction(string fromAcc, string toAcc, double amt, string stat, string type, time_t date);
  
  // Getters
  string getFromAccount() const;
@@ -712,11 +2405,29 @@ public:
  void setStatus(string newStatus);
  void setTransactionType(string newType);
 
- // Save to JSON
- void saveTransaction(const string& filename = "transactions.json");
+ // Conversion to and from the on-disk journal record
+ JournalRecord toRecord() const;
+ static Transaction fromRecord(const JournalRecord& record);
+
+ // Queue for the transaction journal without waiting for the disk; returns the
+ // sequence number to pass to JournalQueue::waitDurable when that matters
+ uint64_t saveTransaction(const string& filename = "transactions.journal");
+
+ // Hand fn one page of the transactions matching filter, newest first, starting at
+ // cursor (firstPage for the newest); the page returned says where the next one starts.
+ // Records still in the journal queue are included. See query.h.
+ static TransactionPage queryTransactions(const TransactionFilter& filter, uint64_t cursor, size_t limit,
+                                          const function<void(const Transaction&)>& fn,
+                                          const string& filename = "transactions.journal");
+
+ // Print one such page
+ static TransactionPage loadTransactions(const TransactionFilter& filter = TransactionFilter(),
+                                         uint64_t cursor = firstPage, size_t limit = 20,
+                                         const string& filename = "transactions.journal");
 
- // Static function to load transactions
- static void loadTransactions(const string& filename = "transactions.json");
+ // One-time import of a legacy transactions.json into the journal
+ static size_t importTransactions(const string& jsonFile = "transactions.json",
+                                  const string& journalFile = "transactions.journal");
 };
 
 #endif // FUNCTIONS_H
@@ -0,0 +1,129 @@
+// ----------------------------Bulk transaction file reader implementation--------------------------------
+
+#include "bank.h"
+#include "batch_file.h"
+
+using namespace Banking;
+using namespace Banking::Exceptions;
+
+namespace
+{
+    bool endsWith(const string& text, const string& suffix)
+    {
+        return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    string trim(const string& text)
+    {
+        size_t first = text.find_first_not_of(" \t\r");
+        if (first == string::npos) return "";
+        size_t last = text.find_last_not_of(" \t\r");
+        return text.substr(first, last - first + 1);
+    }
+
+    // Map a type name to its BatchOpType, false for anything else
+    bool parseType(string name, BatchOpType& type)
+    {
+        transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return tolower(c); });
+        if (name == "deposit") type = BatchOpType::Deposit;
+        else if (name == "withdrawal" || name == "withdraw") type = BatchOpType::Withdrawal;
+        else if (name == "transfer") type = BatchOpType::Transfer;
+        else return false;
+        return true;
+    }
+}
+
+BatchFileReader::BatchFileReader(const string& path)
+    : streamBuffer(1 << 16), csv(endsWith(path, ".csv")), lineNumber(0)
+{
+    file.rdbuf()->pubsetbuf(streamBuffer.data(), streamBuffer.size());
+    file.open(path, ios::binary);
+    if (!file.is_open()) {
+        throw FileException("Cannot open batch file: " + path);
+    }
+}
+
+bool BatchFileReader::next(BatchRecord& out)
+{
+    while (getline(file, line)) {
+        lineNumber++;
+        if (line.find_first_not_of(" \t\r") == string::npos) continue;
+        if (csv && lineNumber == 1 && trim(line.substr(0, line.find(','))) == "type") continue;
+
+        out.line = lineNumber;
+        out.account.clear();
+        out.toAccount.clear();
+        out.amount.clear();
+        out.error.clear();
+        if (csv) parseCsv(out);
+        else parseJson(out);
+        return true;
+    }
+    return false;
+}
+
+void BatchFileReader::parseCsv(BatchRecord& out)
+{
+    string fields[4];
+    size_t count = 0;
+    size_t start = 0;
+    bool extra = false;                 // a comma after the fourth field
+    while (true) {
+        size_t comma = line.find(',', start);
+        fields[count++] = trim(line.substr(start, comma == string::npos ? string::npos : comma - start));
+        if (comma == string::npos) break;
+        start = comma + 1;
+        if (count == 4) {
+            extra = true;
+            break;
+        }
+    }
+    if (count < 3 || extra) {
+        out.error = "Expected type,account,amount[,toAccount]";
+        return;
+    }
+    if (!parseType(fields[0], out.type)) {
+        out.error = "Unknown transaction type: " + fields[0];
+        return;
+    }
+    out.account = fields[1];
+    out.amount = fields[2];
+    out.toAccount = fields[3];
+}
+
+string Banking::quoteCsv(const string& field)
+{
+    string out = "\"";
+    for (char c : field) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    out += '"';
+    return out;
+}
+
+void BatchFileReader::parseJson(BatchRecord& out)
+{
+    json j = json::parse(line, nullptr, false);
+    if (j.is_discarded() || !j.is_object()) {
+        out.error = "Malformed JSON";
+        return;
+    }
+    auto type = j.find("type");
+    if (type == j.end() || !type->is_string() || !parseType(type->get<string>(), out.type)) {
+        out.error = "Missing or unknown transaction type";
+        return;
+    }
+    auto account = j.find("account");
+    if (account != j.end() && account->is_string()) out.account = account->get<string>();
+    auto toAccount = j.find("toAccount");
+    if (toAccount != j.end() && toAccount->is_string()) out.toAccount = toAccount->get<string>();
+
+    // Keep the amount as text: dump() prints a JSON number the way it was written
+    auto amount = j.find("amount");
+    if (amount == j.end() || !(amount->is_number() || amount->is_string())) {
+        out.error = "Missing amount";
+        return;
+    }
+    out.amount = amount->is_string() ? amount->get<string>() : amount->dump();
+}
@@ -0,0 +1,62 @@
+#ifndef BATCH_FILE_H
+#define BATCH_FILE_H
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// ----------------------------Bulk transaction files--------------------------------
+//
+// Input for Bank::applyBatchFile, read one line at a time so files of any size stream
+// in constant memory. Two formats, chosen by extension:
+//
+//     .csv     type,account,amount[,toAccount]     (an optional header line starts with "type")
+//     other    one JSON object per line (JSONL):
+//              {"type": "transfer", "account": "MDBSCE24001", "amount": 250.5, "toAccount": "MDBSCE24002"}
+//
+// type is deposit, withdrawal or transfer (case-insensitive). account is the account
+// credited by a deposit and debited by a withdrawal or transfer. Amounts are kept as
+// text so the Bank converts them exactly. Blank lines are skipped, and a CSV line with
+// fewer than three or more than four fields comes back as malformed.
+
+namespace Banking
+{
+    enum class BatchOpType { Deposit, Withdrawal, Transfer };
+
+    struct BatchRecord
+    {
+        size_t line = 0;                // 1-based line number in the file
+        BatchOpType type = BatchOpType::Deposit;
+        std::string account;
+        std::string toAccount;
+        std::string amount;
+        std::string error;              // set when the line could not be parsed
+    };
+
+    // field as one quoted CSV field (RFC 4180): in double quotes, with any quote doubled
+    std::string quoteCsv(const std::string& field);
+
+    class BatchFileReader
+    {
+    private:
+        std::vector<char> streamBuffer;
+        std::ifstream file;
+        bool csv;
+        size_t lineNumber;
+        std::string line;
+
+        void parseCsv(BatchRecord& out);
+        void parseJson(BatchRecord& out);
+
+    public:
+        // Throws FileException when the file cannot be opened
+        explicit BatchFileReader(const std::string& path);
+
+        // Next non-blank line; false at the end of the file. Malformed lines come back
+        // with error set rather than stopping the stream.
+        bool next(BatchRecord& out);
+    };
+}
+
+#endif // BATCH_FILE_H
@@ -0,0 +1,1634 @@
+// ----------------------------Benchmarks--------------------------------
+//
+// Usage: ./bench.out [name] [sizes...]
+// Every benchmark runs inside a fresh scratch directory so the real data files
+// next to the binary are never read or written.
+
+#include "bank.h"
+#include "archive.h"
+#include "journal_index.h"
+#include "segment.h"
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <random>
+#include <thread>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Banking;
+using Clock = chrono::steady_clock;
+
+namespace
+{
+    double elapsedMs(Clock::time_point start)
+    {
+        return chrono::duration<double, milli>(Clock::now() - start).count();
+    }
+
+    // Create a scratch directory and make it the working directory
+    string enterScratchDir()
+    {
+        char pattern[] = "/tmp/madina-bench-XXXXXX";
+        if (!mkdtemp(pattern) || chdir(pattern) != 0) {
+            throw Exceptions::FileException("Cannot create scratch directory");
+        }
+        return pattern;
+    }
+
+    string syntheticAccountNumber(size_t i)
+    {
+        return "MDBSCE" + to_string(24001 + i);
+    }
+
+    // Write n accounts in the same layout as saveAccountsToFile
+    void writeSyntheticAccounts(const string& path, size_t n)
+    {
+        ofstream file(path);
+        file << "[\n";
+        for (size_t i = 0; i < n; i++) {
+            file << "    {\"accountNumber\": \"" << syntheticAccountNumber(i) << "\", "
+                 << "\"balance\": " << (i % 50000) << ".0, "
+                 << "\"type\": \"" << (i % 4 == 0 ? "Business" : "Saving") << "\", "
+                 << "\"customerInfo\": {\"name\": \"Customer " << i << "\", "
+                 << "\"dob\": \"01-01-2000\", \"cnic\": \"38401" << (1000000 + i) << "\", "
+                 << "\"address\": \"Street " << i % 997 << ", Lahore\", "
+                 << "\"openingDate\": \"2025-05-04 19:24:53\"}}"
+                 << (i + 1 < n ? ",\n" : "\n");
+        }
+        file << "]\n";
+    }
+
+    // Peak resident set size of the process so far, in MiB
+    double peakRssMb()
+    {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss / 1024.0;
+    }
+
+    vector<size_t> sizesOr(const vector<size_t>& given, const vector<size_t>& defaults)
+    {
+        return given.empty() ? defaults : given;
+    }
+}
+
+// Startup cost of loading accounts.json into the Bank
+void benchLoad(const vector<size_t>& args)
+{
+    Bank<double>* bank = Bank<double>::getInstance();
+    cout << "accounts,load_ms,accounts_per_sec,peak_rss_mb\n";
+    for (size_t n : sizesOr(args, {10000, 100000, 1000000})) {
+        string path = "load-" + to_string(n) + ".json";
+        writeSyntheticAccounts(path, n);
+
+        auto start = Clock::now();
+        bank->loadAccountsFromFile(path);
+        double ms = elapsedMs(start);
+
+        if (bank->accountCount() != n) {
+            throw Exceptions::AccountException("Loaded account count does not match");
+        }
+        cout << n << "," << ms << "," << static_cast<long long>(n / (ms / 1000.0))
+             << "," << peakRssMb() << "\n";
+        remove(path.c_str());
+    }
+}
+
+// Time until the first findAccount answers: JSON parse vs. mapped binary snapshot
+void benchSnapshot(const vector<size_t>& args)
+{
+    Bank<double>* bank = Bank<double>::getInstance();
+    cout << "accounts,json_ms,snapshot_ms,mmap_lookup_ms,json_bytes,snapshot_bytes\n";
+    for (size_t n : sizesOr(args, {1000000})) {
+        string path = "snap-" + to_string(n) + ".json";
+        string snapPath = AccountSnapshot::pathFor(path);
+        string probe = syntheticAccountNumber(n / 2);
+        writeSyntheticAccounts(path, n);
+        remove(snapPath.c_str());
+
+        auto start = Clock::now();
+        bank->loadAccountsFromFile(path);
+        if (!bank->findAccount(probe)) throw Exceptions::AccountException("Probe missing (json)");
+        double jsonMs = elapsedMs(start);
+
+        bank->saveAccountsToFile();     // rewrites the JSON and writes the snapshot
+
+        start = Clock::now();
+        bank->loadAccountsFromFile(path);
+        if (!bank->findAccount(probe)) throw Exceptions::AccountException("Probe missing (snapshot)");
+        double snapMs = elapsedMs(start);
+
+        start = Clock::now();
+        AccountSnapshot snapshot;
+        if (!snapshot.open(snapPath) || snapshot.find(probe) < 0) {
+            throw Exceptions::AccountException("Probe missing (mmap)");
+        }
+        double mmapMs = elapsedMs(start);
+
+        ifstream jsonFile(path, ios::binary | ios::ate);
+        ifstream snapFile(snapPath, ios::binary | ios::ate);
+        cout << n << "," << jsonMs << "," << snapMs << "," << mmapMs << ","
+             << jsonFile.tellg() << "," << snapFile.tellg() << "\n";
+        remove(path.c_str());
+        remove(snapPath.c_str());
+    }
+}
+
+// findAccount lookups: std::map<string, ...> vs. the open-addressing AccountIndex
+void benchIndex(const vector<size_t>& args)
+{
+    cout << "accounts,lookups,map_mlookups_per_sec,index_mlookups_per_sec\n";
+    for (size_t n : sizesOr(args, {1000000})) {
+        vector<string> numbers;
+        numbers.reserve(n);
+        for (size_t i = 0; i < n; i++) numbers.push_back(syntheticAccountNumber(i));
+
+        map<string, size_t> tree;
+        AccountIndex<size_t> index;
+        for (size_t i = 0; i < n; i++) {
+            tree.emplace(numbers[i], i);
+            index.insert(numbers[i], i);
+        }
+
+        // Look accounts up in random order, as the customer menus do
+        const size_t lookups = 4 * n;
+        vector<uint32_t> order(lookups);
+        mt19937 rng(42);
+        for (auto& o : order) o = static_cast<uint32_t>(rng() % n);
+
+        size_t checksum = 0;
+        auto start = Clock::now();
+        for (uint32_t o : order) checksum += tree.find(numbers[o])->second;
+        double mapMs = elapsedMs(start);
+
+        size_t indexChecksum = 0;
+        start = Clock::now();
+        for (uint32_t o : order) indexChecksum += *index.find(numbers[o]);
+        double indexMs = elapsedMs(start);
+
+        if (checksum != indexChecksum) throw Exceptions::AccountException("Index lookup mismatch");
+        cout << n << "," << lookups << "," << lookups / mapMs / 1000.0 << ","
+             << lookups / indexMs / 1000.0 << "\n";
+    }
+}
+
+// Full scan (total balance and zakat-eligible savers): heap pointers vs. AccountStore
+// objects vs. AccountStore hot columns
+void benchScan(const vector<size_t>& args)
+{
+    cout << "accounts,pointer_vector_ms,store_ms,hot_columns_ms,speedup_vs_pointers\n";
+    for (size_t n : sizesOr(args, {1000000})) {
+        PersonalInfo info;
+        info.name = "Customer";
+        info.address = "Lahore";
+
+        // Old layout: every account its own heap object, with other allocations in between
+        vector<BankAccount<double>*> pointers;
+        vector<unique_ptr<char[]>> unrelated;
+        AccountStore<double> store;
+        mt19937 rng(7);
+        for (size_t i = 0; i < n; i++) {
+            string accNum = syntheticAccountNumber(i);
+            double balance = static_cast<double>(rng() % 50000);
+            if (i % 4 == 0) {
+                pointers.push_back(new BusinessAccount<double>(accNum, balance, info, "LinkedSystem"));
+                store.emplaceBusiness(accNum, balance, info, "LinkedSystem");
+            } else {
+                pointers.push_back(new SavingAccount<double>(accNum, balance, info, 0.0, 0, true));
+                store.emplaceSaving(accNum, balance, info, 0.0, 0, true);
+            }
+            unrelated.emplace_back(new char[16 + rng() % 240]);
+        }
+
+        const int passes = 5;
+        double pointerTotal = 0;
+        size_t pointerEligible = 0;
+        auto start = Clock::now();
+        for (int p = 0; p < passes; p++) {
+            for (auto* acc : pointers) {
+                pointerTotal += acc->getBalance();
+                if (acc->accountType() == "Saving" && acc->getBalance() >= 20000) pointerEligible++;
+            }
+        }
+        double pointerMs = elapsedMs(start) / passes;
+
+        double storeTotal = 0;
+        size_t storeEligible = 0;
+        start = Clock::now();
+        for (int p = 0; p < passes; p++) {
+            store.forEach([&](auto& acc) {
+                using AccountType = typename decay<decltype(acc)>::type;
+                storeTotal += acc.getBalance();
+                if (is_same<AccountType, SavingAccount<double>>::value && acc.getBalance() >= 20000) {
+                    storeEligible++;
+                }
+            });
+        }
+        double storeMs = elapsedMs(start) / passes;
+
+        double hotTotal = 0;
+        size_t hotEligible = 0;
+        start = Clock::now();
+        for (int p = 0; p < passes; p++) {
+            store.forEachHotChunk([&](HotSpan<double>& span) {
+                for (uint32_t i = 0; i < span.count; i++) {
+                    if (!(span.flags[i] & HotLive)) continue;
+                    double balance = span.balances[i].load();
+                    hotTotal += balance;
+                    hotEligible += span.types[i] == HotSaving && balance >= 20000;
+                }
+            });
+        }
+        double hotMs = elapsedMs(start) / passes;
+
+        if (pointerTotal != storeTotal || pointerEligible != storeEligible ||
+            storeTotal != hotTotal || storeEligible != hotEligible) {
+            throw Exceptions::AccountException("Scan results differ");
+        }
+        cout << n << "," << pointerMs << "," << storeMs << "," << hotMs << "," << pointerMs / hotMs << "\n";
+        for (auto* acc : pointers) delete acc;
+    }
+}
+
+// Bulk deposits, aggregation and a zakat run over the hot balance column with float,
+// double and Money balances. Deposits are random amounts with cents; drift is the
+// difference from the exact total kept in integer minor units.
+template<typename B>
+void runAmountBench(const char* name, size_t n, const vector<int64_t>& depositsMinor, int64_t exactMinor)
+{
+    AccountStore<B> store;
+    PersonalInfo info;
+    vector<uint32_t> rows;
+    rows.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        if (i % 4 == 0) rows.push_back(store.emplaceBusiness(syntheticAccountNumber(i), B(), info, "LinkedSystem"));
+        else rows.push_back(store.emplaceSaving(syntheticAccountNumber(i), B(), info, B(), 0, true));
+    }
+    vector<B> amounts;
+    amounts.reserve(depositsMinor.size());
+    for (int64_t minor : depositsMinor) amounts.push_back(AmountTraits<B>::fromDouble(minor / 100.0));
+
+    auto start = Clock::now();
+    for (size_t k = 0; k < amounts.size(); k++) {
+        store.balanceAt(rows[k % n]) += amounts[k];
+    }
+    double depositMs = elapsedMs(start);
+
+    B total = B();
+    start = Clock::now();
+    store.forEachHotChunk([&total](HotSpan<B>& span) {
+        for (uint32_t i = 0; i < span.count; i++) {
+            if (span.flags[i] & HotLive) total += span.balances[i].load();
+        }
+    });
+    double sumMs = elapsedMs(start);
+
+    B zakatTotal = B();
+    start = Clock::now();
+    store.forEachHot([&zakatTotal](uint32_t, BalanceCell<B>& cell, uint8_t type) {
+        B balance = cell.load();
+        if (type == HotSaving && balance >= 20000) {
+            B zakat = AmountTraits<B>::mulDiv(balance, 25, 1000, Rounding::HalfEven);
+            cell -= zakat;
+            zakatTotal += zakat;
+        }
+    });
+    double zakatMs = elapsedMs(start);
+
+    double drift = AmountTraits<B>::toDouble(total) - exactMinor / 100.0;
+    cout << name << "," << n << "," << amounts.size() << "," << depositMs << ","
+         << amounts.size() / depositMs / 1000.0 << "," << sumMs << "," << zakatMs << ","
+         << fixed << setprecision(2) << AmountTraits<B>::toDouble(total) << "," << drift << ","
+         << AmountTraits<B>::toDouble(zakatTotal) << defaultfloat << setprecision(6) << "\n";
+}
+
+void benchMoney(const vector<size_t>& args)
+{
+    cout << "type,accounts,deposits,deposit_ms,deposits_per_us,sum_ms,zakat_ms,total,drift,zakat_total\n";
+    for (size_t n : sizesOr(args, {1000000})) {
+        mt19937_64 rng(11);
+        vector<int64_t> deposits(n * 8);
+        int64_t exactMinor = 0;
+        for (auto& minor : deposits) {
+            minor = static_cast<int64_t>(rng() % 1000000);    // up to 9999.99
+            exactMinor += minor;
+        }
+        runAmountBench<float>("float", n, deposits, exactMinor);
+        runAmountBench<double>("double", n, deposits, exactMinor);
+        runAmountBench<Money>("Money", n, deposits, exactMinor);
+    }
+}
+
+// Random deposits and withdrawals from 1..N threads on one Bank. Batches are kept out
+// of the timed region (large batch size, no sync) so the numbers show the locking, and
+// cout is muted because the account classes print every balance change.
+void benchThreads(const vector<size_t>& args)
+{
+    Bank<double>* bank = Bank<double>::getInstance();
+    size_t accounts = args.empty() ? 100000 : args[0];
+    const size_t opsPerThread = 200000;
+    string path = "threads.json";
+    writeSyntheticAccounts(path, accounts);
+    bank->loadAccountsFromFile(path);
+
+    PersistenceOptions options;
+    options.batchSize = SIZE_MAX;
+    options.flushInterval = chrono::hours(1);
+    options.durability = Durability::None;
+    bank->setPersistenceOptions(options);
+
+    vector<string> numbers;
+    for (size_t i = 0; i < accounts; i++) numbers.push_back(syntheticAccountNumber(i));
+
+    size_t maxThreads = args.size() > 1 ? args[1] : max(1u, thread::hardware_concurrency());
+    cout << "accounts,threads,ops,ms,ops_per_sec,speedup\n";
+    double baseRate = 0;
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        cout.setstate(ios::badbit);
+        auto start = Clock::now();
+        vector<thread> workers;
+        for (size_t t = 0; t < threads; t++) {
+            workers.emplace_back([&, t]() {
+                mt19937 rng(static_cast<unsigned>(t + 1));
+                for (size_t k = 0; k < opsPerThread; k++) {
+                    const string& accNum = numbers[rng() % accounts];
+                    try {
+                        if (k % 2 == 0) bank->deposit(accNum, 10.0);
+                        else bank->withdraw(accNum, 10.0);
+                    } catch (const Exceptions::TransactionException&) {
+                        // insufficient balance, still a completed operation
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        double ms = elapsedMs(start);
+        cout.clear();
+
+        double rate = threads * opsPerThread / (ms / 1000.0);
+        if (threads == 1) baseRate = rate;
+        cout << accounts << "," << threads << "," << threads * opsPerThread << "," << ms << ","
+             << static_cast<long long>(rate) << "," << rate / baseRate << "\n";
+    }
+
+    bank->setPersistenceOptions(PersistenceOptions());
+    bank->flush();
+    remove(path.c_str());
+}
+
+// Random transfers among a few hot accounts from 1..N threads. Every transfer takes two
+// stripe locks and appends one journal record; the book total must not change.
+void benchTransfer(const vector<size_t>& args)
+{
+    Bank<double>* bank = Bank<double>::getInstance();
+    const size_t accounts = 1000;
+    const size_t transfersPerThread = 50000;
+    string path = "transfer.json";
+    writeSyntheticAccounts(path, accounts);
+    bank->loadAccountsFromFile(path);
+
+    PersistenceOptions options;
+    options.batchSize = SIZE_MAX;
+    options.flushInterval = chrono::hours(1);
+    options.durability = Durability::None;
+    bank->setPersistenceOptions(options);
+
+    size_t maxThreads = max<size_t>(4, thread::hardware_concurrency());
+    cout << "hot_accounts,threads,transfers,ms,transfers_per_sec\n";
+    for (size_t hot : sizesOr(args, {2, 8, 64})) {
+        vector<string> numbers;
+        cout.setstate(ios::badbit);
+        for (size_t i = 0; i < hot; i++) {
+            numbers.push_back(syntheticAccountNumber(i + 1));    // account 0 starts empty
+            bank->deposit(numbers.back(), 1e9);
+        }
+        cout.clear();
+        for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+            double before = bank->totalBalance();
+            cout.setstate(ios::badbit);
+            auto start = Clock::now();
+            vector<thread> workers;
+            for (size_t t = 0; t < threads; t++) {
+                workers.emplace_back([&, t]() {
+                    mt19937 rng(static_cast<unsigned>(t + 1));
+                    for (size_t k = 0; k < transfersPerThread; k++) {
+                        size_t from = rng() % hot;
+                        size_t to = (from + 1 + rng() % (hot - 1)) % hot;
+                        bank->transfer(numbers[from], numbers[to], 1.0 + rng() % 100);
+                    }
+                });
+            }
+            for (auto& worker : workers) worker.join();
+            double ms = elapsedMs(start);
+            cout.clear();
+
+            if (bank->totalBalance() != before) throw Exceptions::TransactionException("Transfers changed the total");
+            size_t total = threads * transfersPerThread;
+            cout << hot << "," << threads << "," << total << "," << ms << ","
+                 << static_cast<long long>(total / (ms / 1000.0)) << "\n";
+        }
+    }
+
+    bank->setPersistenceOptions(PersistenceOptions());
+    bank->flush();
+    remove(path.c_str());
+}
+
+namespace
+{
+    // The pre-atomic balance: a Money guarded by its own mutex
+    struct alignas(64) LockedBalance
+    {
+        mutex lock;
+        Money value;
+    };
+
+    // Run fn(thread, op) opsPerThread times on each of n threads and return the wall time
+    template<typename F>
+    double timeThreads(size_t threads, size_t opsPerThread, F fn)
+    {
+        auto start = Clock::now();
+        vector<thread> workers;
+        for (size_t t = 0; t < threads; t++) {
+            workers.emplace_back([&fn, t, opsPerThread]() {
+                for (size_t k = 0; k < opsPerThread; k++) fn(t, k);
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        return elapsedMs(start);
+    }
+}
+
+// Many threads crediting the same few accounts, as when every salary lands on one
+// payroll account. Compares a mutex-guarded balance, the atomic BalanceCell on its own,
+// and Bank<Money>::deposit end to end (index lookup, atomic add, dirty tracking).
+void benchCredit(const vector<size_t>& args)
+{
+    const size_t opsPerThread = 200000;
+    const Money credit = Money::fromMinor(125);
+    size_t maxThreads = max<size_t>(4, thread::hardware_concurrency());
+
+    Bank<Money>* bank = Bank<Money>::getInstance();
+    string path = "credit.json";
+    writeSyntheticAccounts(path, 64);
+    bank->loadAccountsFromFile(path);
+
+    PersistenceOptions options;
+    options.batchSize = SIZE_MAX;
+    options.flushInterval = chrono::hours(1);
+    options.durability = Durability::None;
+    bank->setPersistenceOptions(options);
+
+    cout << "hot_accounts,threads,ops,mutex_ops_per_sec,atomic_ops_per_sec,deposit_ops_per_sec,atomic_speedup\n";
+    for (size_t hot : sizesOr(args, {1, 4})) {
+        vector<string> numbers;
+        for (size_t i = 0; i < hot; i++) numbers.push_back(syntheticAccountNumber(i));
+
+        for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+            size_t total = threads * opsPerThread;
+            Money expected = credit * static_cast<int64_t>(total);
+
+            vector<LockedBalance> locked(hot);
+            double mutexMs = timeThreads(threads, opsPerThread, [&](size_t t, size_t k) {
+                LockedBalance& cell = locked[(t + k) % hot];
+                lock_guard<mutex> guard(cell.lock);
+                cell.value += credit;
+            });
+
+            vector<BalanceCell<Money>> cells(hot);
+            double atomicMs = timeThreads(threads, opsPerThread, [&](size_t t, size_t k) {
+                cells[(t + k) % hot].add(credit);
+            });
+
+            Money before = bank->totalBalance();
+            cout.setstate(ios::badbit);
+            double depositMs = timeThreads(threads, opsPerThread, [&](size_t t, size_t k) {
+                bank->deposit(numbers[(t + k) % hot], credit);
+            });
+            cout.clear();
+
+            Money mutexSum, atomicSum;
+            for (size_t i = 0; i < hot; i++) {
+                mutexSum += locked[i].value;
+                atomicSum += cells[i].load();
+            }
+            if (mutexSum != expected || atomicSum != expected || bank->totalBalance() - before != expected) {
+                throw Exceptions::TransactionException("Credits were lost");
+            }
+
+            cout << hot << "," << threads << "," << total << ","
+                 << static_cast<long long>(total / (mutexMs / 1000.0)) << ","
+                 << static_cast<long long>(total / (atomicMs / 1000.0)) << ","
+                 << static_cast<long long>(total / (depositMs / 1000.0)) << ","
+                 << mutexMs / atomicMs << "\n";
+        }
+    }
+
+    bank->setPersistenceOptions(PersistenceOptions());
+    bank->flush();
+    remove(path.c_str());
+}
+
+// Producer-side cost of recording a transaction from 1..N threads: a synchronous
+// append (write call under the journal mutex) vs. an enqueue onto the JournalQueue.
+// Enqueue latencies are sampled per call; the queue is flushed outside the timed region.
+void benchJournal(const vector<size_t>& args)
+{
+    const size_t recordsPerThread = args.empty() ? 100000 : args[0];
+    size_t maxThreads = args.size() > 1 ? args[1] : max<size_t>(4, thread::hardware_concurrency());
+
+    JournalRecord sample;
+    sample.fromAccount = "MDBSCE24001";
+    sample.toAccount = "MDBSCE24002";
+    sample.amount = 125.5;
+    sample.status = "Completed";
+    sample.transactionType = "Transfer";
+    sample.date = static_cast<int64_t>(time(nullptr));
+
+    cout << "threads,records,append_ns_per_op,enqueue_ns_per_op,enqueue_p50_ns,enqueue_p99_ns,"
+         << "batches,peak_occupancy,producer_stalls\n";
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        size_t total = threads * recordsPerThread;
+        string appendPath = "append-" + to_string(threads) + ".journal";
+        string queuePath = "queue-" + to_string(threads) + ".journal";
+
+        double appendMs;
+        {
+            TransactionJournal journal(appendPath);
+            appendMs = timeThreads(threads, recordsPerThread, [&](size_t, size_t) { journal.append(sample); });
+        }
+
+        TransactionJournal journal(queuePath);
+        JournalQueue queue(journal);
+        vector<vector<uint32_t>> latencies(threads, vector<uint32_t>(recordsPerThread));
+        double enqueueMs = timeThreads(threads, recordsPerThread, [&](size_t t, size_t k) {
+            auto start = Clock::now();
+            queue.enqueue(sample);
+            latencies[t][k] = static_cast<uint32_t>(chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start).count());
+        });
+        queue.flush();
+        JournalQueueStats stats = queue.stats();
+
+        size_t written = 0;
+        TransactionJournal::forEach(queuePath, [&written](const JournalRecord&, uint64_t) { written++; return true; });
+        if (written != total) throw Exceptions::FileException("Queued records missing from the journal");
+
+        vector<uint32_t> all;
+        for (auto& l : latencies) all.insert(all.end(), l.begin(), l.end());
+        sort(all.begin(), all.end());
+        cout << threads << "," << total << "," << appendMs * 1e6 / total << "," << enqueueMs * 1e6 / total << ","
+             << all[all.size() / 2] << "," << all[all.size() * 99 / 100] << ","
+             << stats.batches << "," << stats.peakOccupancy << "," << stats.producerStalls << "\n";
+        remove(appendPath.c_str());
+        remove(queuePath.c_str());
+    }
+}
+
+// Annual zakat for the whole book: processZakat once per saving account (as the menu
+// did) vs. one runZakatCycle pass, dry run and real. Uses the default persistence
+// options, so the per-account path pays for its batches like the app does.
+void benchZakat(const vector<size_t>& args)
+{
+    Bank<Money>* bank = Bank<Money>::getInstance();
+    cout << "accounts,per_account_ms,cycle_dry_run_ms,cycle_ms,charged,total_zakat\n";
+    for (size_t n : sizesOr(args, {100000, 1000000})) {
+        string path = "zakat-" + to_string(n) + ".json";
+        writeSyntheticAccounts(path, n);
+
+        bank->loadAccountsFromFile(path);
+        Money before = bank->totalBalance();
+        cout.setstate(ios::badbit);
+        auto start = Clock::now();
+        for (size_t i = 0; i < n; i++) {
+            if (i % 4 != 0) bank->processZakat(syntheticAccountNumber(i));
+        }
+        bank->flush();
+        double perAccountMs = elapsedMs(start);
+        cout.clear();
+        Money perAccountTotal = before - bank->totalBalance();
+
+        remove(DeltaLog::pathFor(path).c_str());    // start the cycle from the same balances
+        bank->loadAccountsFromFile(path);
+        ZakatReport<Money> dryRun = bank->runZakatCycle(true);
+        ZakatReport<Money> cycle = bank->runZakatCycle();
+        if (dryRun.totalZakat != cycle.totalZakat || cycle.totalZakat != perAccountTotal
+            || before - bank->totalBalance() != cycle.totalZakat) {
+            throw Exceptions::TransactionException("Zakat totals disagree");
+        }
+        cout << n << "," << perAccountMs << "," << dryRun.elapsedMs << "," << cycle.elapsedMs << ","
+             << cycle.lines.size() << "," << cycle.totalZakat << "\n";
+        remove(path.c_str());
+        remove(DeltaLog::pathFor(path).c_str());
+    }
+}
+
+namespace
+{
+    // Reference accrual: tier lookup and rounding per account, with branches
+    template<typename B>
+    void accrueScalar(const vector<B>& balances, const vector<uint8_t>& eligible, vector<B>& due,
+                      const InterestSchedule<B>& schedule)
+    {
+        for (size_t i = 0; i < balances.size(); i++) {
+            due[i] = B();
+            if (!eligible[i]) continue;
+            int64_t rate = 0;
+            for (const auto& tier : schedule.tiers) {
+                if (balances[i] < tier.minBalance) break;
+                rate = tier.annualRateBp;
+            }
+            if (rate > 0) due[i] = AmountTraits<B>::mulDiv(balances[i], rate, 10000 * schedule.daysPerYear, schedule.rounding);
+        }
+    }
+
+    // Per-account loop vs. accrueDailyInterest over n contiguous balances
+    template<typename B>
+    void benchInterestKernel(size_t n, const char* typeName)
+    {
+        InterestSchedule<B> schedule = InterestSchedule<B>::standard();
+        vector<B> balances(n), due(n), reference(n);
+        vector<uint8_t> eligible(n);
+        mt19937_64 rng(17);
+        for (size_t i = 0; i < n; i++) {
+            balances[i] = AmountTraits<B>::fromDouble(static_cast<double>(rng() % 200000000) / 100.0);
+            eligible[i] = i % 4 != 0;
+        }
+
+        auto start = Clock::now();
+        accrueScalar(balances, eligible, reference, schedule);
+        double scalarMs = elapsedMs(start);
+        start = Clock::now();
+        accrueDailyInterest(balances.data(), eligible.data(), due.data(), n, schedule);
+        double kernelMs = elapsedMs(start);
+        if (due != reference) throw Exceptions::TransactionException("Interest kernels disagree");
+
+        B total = B();
+        for (const B& d : due) total += d;
+        cout << n << "," << typeName << "," << scalarMs << "," << kernelMs << ","
+             << n / kernelMs / 1000.0 << "," << total << "\n";
+    }
+}
+
+// Daily interest: the tier kernel alone over n contiguous balances (10M by default),
+// then runInterestAccrual end to end on a Bank of up to 1M accounts. The second run and
+// the run after reloading from disk must credit nothing, since every account already
+// carries the day.
+void benchInterest(const vector<size_t>& args)
+{
+    vector<size_t> sizes = sizesOr(args, {10000000});
+    cout << "accounts,balance_type,per_account_ms,kernel_ms,kernel_m_accounts_per_sec,total_interest\n";
+    for (size_t n : sizes) {
+        benchInterestKernel<Money>(n, "Money");
+        benchInterestKernel<double>(n, "double");
+    }
+
+    Bank<Money>* bank = Bank<Money>::getInstance();
+    cout << "\naccounts,run_ms,credited,windows,rerun_ms,rerun_credited,reload_rerun_credited,total_interest\n";
+    for (size_t n : sizes) {
+        n = min<size_t>(n, 1000000);
+        string path = "interest-" + to_string(n) + ".json";
+        writeSyntheticAccounts(path, n);
+        remove(DeltaLog::pathFor(path).c_str());
+        bank->loadAccountsFromFile(path);
+
+        Money before = bank->totalBalance();
+        InterestReport<Money> run = bank->runInterestAccrual();
+        InterestReport<Money> rerun = bank->runInterestAccrual();
+        bank->loadAccountsFromFile(path);
+        InterestReport<Money> reloaded = bank->runInterestAccrual();
+        if (bank->totalBalance() - before != run.totalInterest || rerun.credited != 0 || reloaded.credited != 0) {
+            throw Exceptions::TransactionException("Interest accrual was not idempotent");
+        }
+        cout << n << "," << run.elapsedMs << "," << run.credited << "," << run.windows << ","
+             << rerun.elapsedMs << "," << rerun.credited << "," << reloaded.credited << ","
+             << run.totalInterest << "\n";
+        remove(path.c_str());
+        remove(DeltaLog::pathFor(path).c_str());
+    }
+}
+
+// Paying every employee: payEmployeeSalary once per employee ID (linear scan, one
+// deposit each) vs. one runPayroll that groups salaries by account
+void benchPayroll(const vector<size_t>& args)
+{
+    Bank<Money>* bank = Bank<Money>::getInstance();
+    const size_t accounts = 1000;
+    string path = "payroll.json";
+    cout << "employees,accounts,per_employee_ms,payroll_ms,payroll_threads,total_paid\n";
+    for (size_t n : sizesOr(args, {1000, 20000})) {
+        writeSyntheticAccounts(path, accounts);
+        bank->loadAccountsFromFile(path);
+
+        ofstream file("employees.json");
+        file << "[\n";
+        for (size_t i = 0; i < n; i++) {
+            file << "    {\"accountNumber\": \"" << syntheticAccountNumber(i % accounts) << "\", "
+                 << "\"designation\": \"cashier\", \"employeeID\": \"emp" << i << "\", "
+                 << "\"name\": \"Employee " << i << "\", \"salary\": " << 15000 + i % 7 << ".5}"
+                 << (i + 1 < n ? ",\n" : "\n");
+        }
+        file << "]\n";
+        file.close();
+        bank->loadEmployeesFromFile();
+
+        Money before = bank->totalBalance();
+        cout.setstate(ios::badbit);
+        auto start = Clock::now();
+        for (size_t i = 0; i < n; i++) bank->payEmployeeSalary("emp" + to_string(i));
+        bank->flush();
+        double perEmployeeMs = elapsedMs(start);
+        cout.clear();
+        Money perEmployeeTotal = bank->totalBalance() - before;
+
+        before = bank->totalBalance();
+        PayrollReport<Money> report = bank->runPayroll();
+        if (report.paid != n || report.totalPaid != perEmployeeTotal
+            || bank->totalBalance() - before != report.totalPaid) {
+            throw Exceptions::TransactionException("Payroll totals disagree");
+        }
+        cout << n << "," << accounts << "," << perEmployeeMs << "," << report.elapsedMs << ","
+             << report.threads << "," << report.totalPaid << "\n";
+
+        remove(path.c_str());
+        remove(DeltaLog::pathFor(path).c_str());
+    }
+}
+
+// Bulk ingestion through applyBatchFile: random deposits, withdrawals and transfers
+// over 100000 accounts, read from JSONL and from CSV, with the default persistence
+// options and a per-record report
+void benchBatch(const vector<size_t>& args)
+{
+    Bank<Money>* bank = Bank<Money>::getInstance();
+    const size_t accounts = 100000;
+    string path = "batch-accounts.json";
+    cout << "records,format,ms,applied,failed,records_per_sec,records_per_min\n";
+    for (size_t n : sizesOr(args, {1000000})) {
+        for (string format : {"jsonl", "csv"}) {
+            writeSyntheticAccounts(path, accounts);
+            remove(DeltaLog::pathFor(path).c_str());
+            bank->loadAccountsFromFile(path);
+
+            string input = "batch." + format;
+            {
+                ofstream file(input);
+                mt19937 rng(11);
+                if (format == "csv") file << "type,account,amount,toAccount\n";
+                for (size_t i = 0; i < n; i++) {
+                    int kind = rng() % 3;
+                    string from = syntheticAccountNumber(rng() % accounts);
+                    string to = syntheticAccountNumber(rng() % accounts);
+                    string amount = to_string(1 + rng() % 500) + "." + to_string(10 + rng() % 90);
+                    const char* type = kind == 0 ? "deposit" : kind == 1 ? "withdrawal" : "transfer";
+                    if (format == "csv") {
+                        file << type << "," << from << "," << amount;
+                        if (kind == 2) file << "," << to;
+                        file << "\n";
+                    } else {
+                        file << "{\"type\": \"" << type << "\", \"account\": \"" << from << "\", \"amount\": " << amount;
+                        if (kind == 2) file << ", \"toAccount\": \"" << to << "\"";
+                        file << "}\n";
+                    }
+                }
+            }
+
+            BatchSummary summary = bank->applyBatchFile(input, input + ".report.csv");
+            if (summary.records != n) throw Exceptions::FileException("Batch records missing");
+            cout << n << "," << format << "," << summary.elapsedMs << "," << summary.applied << ","
+                 << summary.failed << "," << static_cast<long long>(summary.perSecond()) << ","
+                 << static_cast<long long>(summary.perSecond() * 60) << "\n";
+            remove(input.c_str());
+            remove((input + ".report.csv").c_str());
+        }
+    }
+    remove(path.c_str());
+    remove(DeltaLog::pathFor(path).c_str());
+}
+
+// Settling n transfers among 1000 accounts: applied leg by leg through applyBatch
+// (two balance changes and one journal record each) vs. settleNetted (one of each per
+// account that moves). Balances start high enough that no transfer fails, so both
+// paths must end with the same balances.
+void benchNetting(const vector<size_t>& args)
+{
+    Bank<Money>* bank = Bank<Money>::getInstance();
+    const size_t accounts = 1000;
+    string path = "netting.json";
+    cout << "transfers,accounts,eager_ms,eager_journal_records,netted_ms,netted_mutations,net_volume,gross_volume\n";
+
+    // Rewritten before every load: compaction replaces the file with the changed balances
+    auto writeMerchants = [&]() {
+        ofstream file(path);
+        file << "[\n";
+        for (size_t i = 0; i < accounts; i++) {
+            file << "    {\"accountNumber\": \"" << syntheticAccountNumber(i) << "\", \"balance\": 100000000.0, "
+                 << "\"type\": \"Business\", \"customerInfo\": {\"name\": \"Merchant " << i << "\", "
+                 << "\"dob\": \"01-01-2000\", \"cnic\": \"" << 3840100000000 + i << "\", "
+                 << "\"address\": \"Lahore\", \"openingDate\": \"2025-05-04 19:24:53\"}}"
+                 << (i + 1 < accounts ? ",\n" : "\n");
+        }
+        file << "]\n";
+        file.close();
+        remove(DeltaLog::pathFor(path).c_str());
+        remove(AccountSnapshot::pathFor(path).c_str());
+    };
+    for (size_t n : sizesOr(args, {100000, 1000000})) {
+        vector<BatchOp<Money>> transfers(n);
+        mt19937 rng(5);
+        for (auto& op : transfers) {
+            op.type = BatchOpType::Transfer;
+            size_t from = rng() % accounts;
+            size_t to = (from + 1 + rng() % (accounts - 1)) % accounts;
+            op.account = syntheticAccountNumber(from);
+            op.toAccount = syntheticAccountNumber(to);
+            op.amount = Money::fromMinor(100 + rng() % 100000);
+        }
+
+        writeMerchants();
+        bank->loadAccountsFromFile(path);
+        vector<string> errors;
+        auto start = Clock::now();
+        size_t applied = 0;
+        for (size_t first = 0; first < n; first += 4096) {
+            vector<BatchOp<Money>> chunk(transfers.begin() + first, transfers.begin() + min(n, first + 4096));
+            applied += bank->applyBatch(chunk, errors);
+        }
+        bank->flush();
+        double eagerMs = elapsedMs(start);
+        vector<Money> eager;
+        for (size_t i = 0; i < accounts; i++) eager.push_back(bank->findAccount(syntheticAccountNumber(i))->getBalance());
+
+        writeMerchants();
+        bank->loadAccountsFromFile(path);
+        SettlementReport<Money> report = bank->settleNetted(transfers);
+        bool same = applied == n && report.settled;
+        for (size_t i = 0; i < accounts; i++) {
+            same = same && bank->findAccount(syntheticAccountNumber(i))->getBalance() == eager[i];
+        }
+        if (!same) throw Exceptions::TransactionException("Netted balances differ from the eager run");
+        cout << n << "," << accounts << "," << eagerMs << "," << applied << "," << report.elapsedMs << ","
+             << report.mutations << "," << report.netVolume << "," << report.grossVolume << "\n";
+    }
+    remove(path.c_str());
+    remove(DeltaLog::pathFor(path).c_str());
+    remove(AccountSnapshot::pathFor(path).c_str());
+}
+
+// Monthly statements for 10000 accounts from a journal of n records spread over two
+// months: writeStatements with 1 and 4 threads vs. the old way of scanning the whole
+// journal once per account (one scan timed, multiplied by the account count)
+void benchStatements(const vector<size_t>& args)
+{
+    const size_t accounts = 10000;
+    const int64_t day = 86400;
+    const int64_t monthStart = 1759276800;      // 2025-10-01 UTC
+    cout << "records,accounts,threads,scan_ms,render_ms,total_ms,statements,entries,per_account_scan_estimate_ms\n";
+    for (size_t n : sizesOr(args, {1000000, 10000000})) {
+        string journalPath = "statements-" + to_string(n) + ".journal";
+        {
+            ofstream file(journalPath, ios::binary | ios::trunc);
+            mt19937 rng(3);
+            string frames;
+            for (size_t i = 0; i < n; i++) {
+                JournalRecord r;
+                int kind = rng() % 3;
+                string a = syntheticAccountNumber(rng() % accounts);
+                string b = syntheticAccountNumber(rng() % accounts);
+                r.fromAccount = kind == 0 ? "Bank" : a;
+                r.toAccount = kind == 1 ? "Bank" : b;
+                r.amount = (1 + rng() % 100000) / 100.0;
+                r.status = "Completed";
+                r.transactionType = kind == 0 ? "Deposit" : kind == 1 ? "Withdrawal" : "Transfer";
+                r.date = monthStart - 15 * day + static_cast<int64_t>(i * (60 * day) / n);
+                TransactionJournal::encode(r, frames);
+                if (frames.size() > (1 << 20)) {
+                    file << frames;
+                    frames.clear();
+                }
+            }
+            file << frames;
+        }
+
+        StatementRequest request;
+        request.from = monthStart;
+        request.to = monthStart + 31 * day - 1;
+        for (size_t i = 0; i < accounts; i++) {
+            request.balances.emplace_back(syntheticAccountNumber(i), Money::fromMinor(100000000 + i));
+        }
+
+        auto start = Clock::now();
+        size_t matched = 0;
+        string probe = syntheticAccountNumber(0);
+        TransactionJournal::forEach(journalPath, [&](const JournalRecord& r, uint64_t) {
+            matched += r.fromAccount == probe || r.toAccount == probe;
+            return true;
+        });
+        double naiveEstimateMs = elapsedMs(start) * accounts;
+
+        TransactionJournal::shared(journalPath);    // opened (and segmented) before timing
+        for (size_t threads : {1, 4}) {
+            request.threads = threads;
+            request.outputDir = "statements-" + to_string(threads);
+            StatementSummary summary = writeStatements(journalPath, request);
+            if (summary.statements != accounts) throw Exceptions::FileException("Statements missing");
+            cout << n << "," << accounts << "," << threads << "," << summary.scanMs << "," << summary.renderMs << ","
+                 << summary.elapsedMs << "," << summary.statements << "," << summary.entries << ","
+                 << naiveEstimateMs << "\n";
+            for (size_t i = 0; i < accounts; i++) {
+                remove((request.outputDir + "/" + syntheticAccountNumber(i) + ".txt").c_str());
+            }
+            rmdir(request.outputDir.c_str());
+        }
+        remove(journalPath.c_str());
+        remove(JournalAccountIndex::pathFor(journalPath).c_str());
+        remove(SegmentCatalog::pathFor(journalPath).c_str());
+    }
+}
+
+// Reconcile 100000 accounts against a journal of n records: reconcileJournal with 1 and
+// 4 threads vs. one forEach pass summing into a single map. The book is the exact
+// replay with 10 balances nudged by a cent and 5 journaled accounts left out, so every
+// run must report exactly those. peak_rss_mb is the process high-water mark so far.
+void benchReconcile(const vector<size_t>& args)
+{
+    const size_t accounts = 100000;
+    const size_t nudged = 10, missing = 5;
+    cout << "records,accounts,method,threads,replay_ms,total_ms,mismatched,not_in_book,peak_rss_mb\n";
+    for (size_t n : sizesOr(args, {1000000, 10000000})) {
+        string journalPath = "reconcile-" + to_string(n) + ".journal";
+        vector<Money> expected(accounts);
+        {
+            ofstream file(journalPath, ios::binary | ios::trunc);
+            mt19937 rng(5);
+            string frames;
+            for (size_t i = 0; i < n; i++) {
+                JournalRecord r;
+                int kind = rng() % 3;
+                size_t a = rng() % accounts, b = rng() % accounts;
+                r.fromAccount = kind == 0 ? "Bank" : syntheticAccountNumber(a);
+                r.toAccount = kind == 1 ? "Bank" : syntheticAccountNumber(b);
+                r.amount = (1 + rng() % 100000) / 100.0;
+                r.status = rng() % 50 ? "Completed" : "Failed";
+                r.transactionType = kind == 0 ? "Deposit" : kind == 1 ? "Withdrawal" : "Transfer";
+                r.date = 1759276800 + static_cast<int64_t>(i);
+                TransactionJournal::encode(r, frames);
+                if (r.status == "Completed" && r.fromAccount != r.toAccount) {
+                    Money amount = Money::fromDouble(r.amount);
+                    if (kind != 0) expected[a] -= amount;
+                    if (kind != 1) expected[b] += amount;
+                }
+                if (frames.size() > (1 << 20)) {
+                    file << frames;
+                    frames.clear();
+                }
+            }
+            file << frames;
+        }
+
+        ReconcileRequest request;
+        request.reportPath = "reconcile-" + to_string(n) + ".csv";
+        for (size_t i = missing; i < accounts; i++) {
+            Money book = expected[i];
+            if (i % (accounts / nudged) == missing) book += Money::fromMinor(1);
+            request.balances.emplace_back(syntheticAccountNumber(i), book);
+        }
+
+        // Opened (and segmented) before timing, as the Bank's journal is
+        TransactionJournal::shared(journalPath);
+        for (size_t threads : {1, 4}) {
+            request.threads = threads;
+            ReconcileSummary summary = reconcileJournal(journalPath, request);
+            if (summary.mismatched != nudged || summary.notInBook != missing) {
+                throw Exceptions::TransactionException("Reconciliation found the wrong accounts");
+            }
+            cout << n << "," << accounts << ",pipeline," << threads << "," << summary.replayMs << ","
+                 << summary.elapsedMs << "," << summary.mismatched << "," << summary.notInBook << ","
+                 << peakRssMb() << "\n";
+        }
+
+        auto start = Clock::now();
+        unordered_map<string, Money> replayed;
+        TransactionJournal::forEach(journalPath, [&replayed](const JournalRecord& r, uint64_t) {
+            if (r.status != "Completed" || r.fromAccount == r.toAccount) return true;
+            Money amount = Money::fromDouble(r.amount);
+            if (!isExternalParty(r.fromAccount)) replayed[r.fromAccount] -= amount;
+            if (!isExternalParty(r.toAccount)) replayed[r.toAccount] += amount;
+            return true;
+        });
+        double replayMs = elapsedMs(start);
+        size_t mismatched = 0;
+        for (const auto& entry : request.balances) {
+            if (replayed[entry.first] != entry.second) mismatched++;
+        }
+        cout << n << "," << accounts << ",single_map,1," << replayMs << "," << elapsedMs(start) << ","
+             << mismatched << "," << replayed.size() - request.balances.size() << "," << peakRssMb() << "\n";
+        remove(journalPath.c_str());
+        remove(JournalAccountIndex::pathFor(journalPath).c_str());
+        remove(SegmentCatalog::pathFor(journalPath).c_str());
+        remove(request.reportPath.c_str());
+    }
+}
+
+// Point-in-time balances for 100000 accounts over a year-long journal of n records:
+// balanceAsOf from checkpoints taken every checkpointBytes (as the Bank takes them) vs.
+// a scan of the whole history per query. 1000 random queries are checked against one
+// sweep of the journal; query_ms is their mean, open_ms the journal's first open
+// (which builds the time index).
+void benchAsOf(const vector<size_t>& args)
+{
+    const size_t accounts = 100000;
+    const size_t queries = 1000;
+    const uint64_t checkpointBytes = PersistenceOptions().checkpointBytes;
+    const int64_t yearStart = 1735689600;       // 2025-01-01 UTC
+    const int64_t year = 365 * 86400;
+    cout << "records,accounts,checkpoints,checkpoint_mb,open_ms,query_ms,max_query_ms,"
+            "avg_replayed_records,full_scan_ms\n";
+    for (size_t n : sizesOr(args, {1000000, 10000000})) {
+        string journalPath = "asof-" + to_string(n) + ".journal";
+        string logPath = CheckpointLog::pathFor(journalPath);
+        remove(logPath.c_str());
+        vector<Money> balances(accounts, Money(1000));           // opening balances, not journaled
+        {
+            CheckpointLog log(logPath);
+            vector<uint8_t> changed(accounts, 0);
+            vector<uint32_t> changedList;
+            auto checkpoint = [&](uint64_t offset, bool full) {
+                vector<CheckpointEntry> entries;
+                auto add = [&](size_t a) {
+                    CheckpointEntry entry = {};
+                    string accNum = syntheticAccountNumber(a);
+                    memcpy(entry.accountNumber, accNum.data(), accNum.size());
+                    entry.balance = balances[a].minorUnits();
+                    entries.push_back(entry);
+                };
+                if (full) {
+                    for (size_t a = 0; a < accounts; a++) add(a);
+                } else {
+                    for (uint32_t a : changedList) add(a);
+                }
+                for (uint32_t a : changedList) changed[a] = 0;
+                changedList.clear();
+                log.append(offset, full, entries, false);
+            };
+            auto post = [&](size_t a, Money amount) {
+                balances[a] += amount;
+                if (!changed[a]) changedList.push_back(static_cast<uint32_t>(a));
+                changed[a] = 1;
+            };
+            checkpoint(0, true);
+
+            ofstream file(journalPath, ios::binary | ios::trunc);
+            mt19937 rng(9);
+            string frames;
+            uint64_t offset = 0, lastCheckpoint = 0;
+            for (size_t i = 0; i < n; i++) {
+                JournalRecord r;
+                int kind = rng() % 3;
+                size_t a = rng() % accounts, b = rng() % accounts;
+                r.fromAccount = kind == 0 ? "Bank" : syntheticAccountNumber(a);
+                r.toAccount = kind == 1 ? "Bank" : syntheticAccountNumber(b);
+                r.amount = (1 + rng() % 10000) / 100.0;
+                r.status = "Completed";
+                r.transactionType = kind == 0 ? "Deposit" : kind == 1 ? "Withdrawal" : "Transfer";
+                r.date = yearStart + static_cast<int64_t>(i * year / n);
+                size_t before = frames.size();
+                TransactionJournal::encode(r, frames);
+                offset += frames.size() - before;
+                if (r.fromAccount != r.toAccount) {
+                    Money amount = Money::fromDouble(r.amount);
+                    if (kind != 0) post(a, -amount);
+                    if (kind != 1) post(b, amount);
+                }
+                if (offset - lastCheckpoint >= checkpointBytes) {
+                    checkpoint(offset, (log.size() + 1) % fullCheckpointEvery == 0);
+                    lastCheckpoint = offset;
+                }
+                if (frames.size() > (1 << 20)) {
+                    file << frames;
+                    frames.clear();
+                }
+            }
+            file << frames;
+        }
+
+        // Expected answers from one sweep over queries sorted by time
+        mt19937 rng(11);
+        vector<pair<int64_t, size_t>> asked(queries);
+        for (auto& q : asked) q = {yearStart + static_cast<int64_t>(rng() % year), rng() % accounts};
+        sort(asked.begin(), asked.end());
+        vector<Money> expected(queries);
+        {
+            unordered_map<string, Money> running;
+            size_t next = 0;
+            auto answerUpTo = [&](int64_t date) {
+                for (; next < queries && asked[next].first < date; next++) {
+                    auto it = running.find(syntheticAccountNumber(asked[next].second));
+                    expected[next] = Money(1000) + (it == running.end() ? Money() : it->second);
+                }
+            };
+            TransactionJournal::forEach(journalPath, [&](const JournalRecord& r, uint64_t) {
+                answerUpTo(r.date);
+                Money amount = Money::fromDouble(r.amount);
+                if (r.fromAccount != "Bank") running[r.fromAccount] -= amount;
+                if (r.toAccount != "Bank") running[r.toAccount] += amount;
+                return true;
+            });
+            answerUpTo(INT64_MAX);
+        }
+
+        CheckpointLog log(logPath);
+        auto start = Clock::now();
+        uint64_t journalEnd = TransactionJournal::shared(journalPath).size();
+        double openMs = elapsedMs(start);
+        double totalMs = 0, maxMs = 0;
+        size_t replayed = 0;
+        for (size_t q = 0; q < queries; q++) {
+            auto queryStart = Clock::now();
+            HistoricalBalance past = balanceAsOf(journalPath, log, syntheticAccountNumber(asked[q].second),
+                                                 asked[q].first, balances[asked[q].second], journalEnd);
+            double ms = elapsedMs(queryStart);
+            if (past.balance != expected[q]) {
+                throw Exceptions::TransactionException("balanceAsOf disagrees with the journal");
+            }
+            totalMs += ms;
+            maxMs = max(maxMs, ms);
+            replayed += past.replayedRecords;
+        }
+
+        start = Clock::now();
+        const size_t scans = 3;
+        for (size_t k = 0; k < scans; k++) {
+            size_t q = (2 * k + 1) * queries / (2 * scans);       // spread over the year
+            string accNum = syntheticAccountNumber(asked[q].second);
+            Money balance(1000);
+            TransactionJournal::forEach(journalPath, [&](const JournalRecord& r, uint64_t) {
+                if (r.date > asked[q].first) return false;
+                if (r.toAccount == accNum) balance += Money::fromDouble(r.amount);
+                else if (r.fromAccount == accNum) balance -= Money::fromDouble(r.amount);
+                return true;
+            });
+        }
+        double scanMs = elapsedMs(start) / scans;
+
+        struct stat st;
+        stat(logPath.c_str(), &st);
+        cout << n << "," << accounts << "," << log.size() << "," << st.st_size / 1048576.0 << "," << openMs << ","
+             << totalMs / queries << "," << maxMs << "," << replayed / queries << "," << scanMs << "\n";
+        remove(journalPath.c_str());
+        remove(JournalAccountIndex::pathFor(journalPath).c_str());
+        remove(SegmentCatalog::pathFor(journalPath).c_str());
+        remove(logPath.c_str());
+    }
+}
+
+// Per-account history over a journal of n records and 100000 accounts: appends in
+// writer-sized batches with the account index maintained (vs. the same bytes written
+// to a plain file), a reopen that loads the index, and forEachOf for 1000 random
+// accounts vs. a scan of the whole journal per account
+void benchHistory(const vector<size_t>& args)
+{
+    const size_t accounts = 100000;
+    const size_t batchRecords = 4096;
+    const size_t queries = 1000;
+    cout << "records,accounts,plain_write_ms,indexed_append_ms,reopen_ms,index_mb,query_ms,"
+            "avg_records_per_account,full_scan_ms\n";
+    for (size_t n : sizesOr(args, {1000000, 10000000})) {
+        string journalPath = "history-" + to_string(n) + ".journal";
+        vector<string> batches;
+        {
+            mt19937 rng(13);
+            string frames;
+            for (size_t i = 0; i < n; i++) {
+                JournalRecord r;
+                int kind = rng() % 3;
+                r.fromAccount = kind == 0 ? "Bank" : syntheticAccountNumber(rng() % accounts);
+                r.toAccount = kind == 1 ? "Bank" : syntheticAccountNumber(rng() % accounts);
+                r.amount = (1 + rng() % 100000) / 100.0;
+                r.status = "Completed";
+                r.transactionType = kind == 0 ? "Deposit" : kind == 1 ? "Withdrawal" : "Transfer";
+                r.date = 1759276800 + static_cast<int64_t>(i);
+                TransactionJournal::encode(r, frames);
+                if ((i + 1) % batchRecords == 0 || i + 1 == n) {
+                    batches.push_back(move(frames));
+                    frames.clear();
+                }
+            }
+        }
+
+        auto start = Clock::now();
+        {
+            ofstream plain("history-plain.journal", ios::binary | ios::trunc);
+            for (const string& batch : batches) plain.write(batch.data(), batch.size());
+        }
+        double plainMs = elapsedMs(start);
+        remove("history-plain.journal");
+
+        remove(journalPath.c_str());
+        remove(JournalAccountIndex::pathFor(journalPath).c_str());
+        remove(SegmentCatalog::pathFor(journalPath).c_str());
+        TransactionJournal& journal = TransactionJournal::shared(journalPath);
+        start = Clock::now();
+        for (const string& batch : batches) journal.appendEncoded(batch);
+        double appendMs = elapsedMs(start);
+        vector<string>().swap(batches);
+
+        start = Clock::now();
+        {
+            TransactionJournal reopened(journalPath);
+        }
+        double reopenMs = elapsedMs(start);
+
+        mt19937 rng(17);
+        vector<string> asked(queries);
+        for (auto& accNum : asked) accNum = syntheticAccountNumber(rng() % accounts);
+        size_t found = 0;
+        start = Clock::now();
+        for (const string& accNum : asked) {
+            found += journal.forEachOf(accNum, [](const JournalRecord&, uint64_t) {});
+        }
+        double queryMs = elapsedMs(start) / queries;
+
+        const size_t scans = 3;
+        start = Clock::now();
+        for (size_t q = 0; q < scans; q++) {
+            size_t scanned = 0;
+            TransactionJournal::forEach(journalPath, [&](const JournalRecord& r, uint64_t) {
+                scanned += r.fromAccount == asked[q] || r.toAccount == asked[q];
+                return true;
+            });
+            if (scanned != journal.forEachOf(asked[q], [](const JournalRecord&, uint64_t) {})) {
+                throw Exceptions::TransactionException("Account index disagrees with the journal");
+            }
+        }
+        double scanMs = elapsedMs(start) / scans;
+
+        struct stat st;
+        stat(JournalAccountIndex::pathFor(journalPath).c_str(), &st);
+        cout << n << "," << accounts << "," << plainMs << "," << appendMs << "," << reopenMs << ","
+             << st.st_size / 1048576.0 << "," << queryMs << "," << found / queries << "," << scanMs << "\n";
+        remove(journalPath.c_str());
+        remove(JournalAccountIndex::pathFor(journalPath).c_str());
+        remove(SegmentCatalog::pathFor(journalPath).c_str());
+    }
+}
+
+// Paged transaction queries over a year-long journal of n records: the first page and
+// every page after it (through the cursor) for a few filters, against the one full scan
+// the old viewer made to list everything. Every filter's pages are checked against
+// that scan. Zakat records land on the first of each month only, so a type filter
+// skips the other days' segments by their per-type counts.
+void benchQuery(const vector<size_t>& args)
+{
+    const size_t batchRecords = 4096;
+    const size_t pageSize = 20;
+    const size_t accounts = 100000;
+    const int64_t yearStart = 1735689600;     // 2025-01-01 00:00 UTC
+    const int64_t day = SegmentCatalog::segmentSeconds;
+    cout << "records,filter,matches,first_page_ms,pages,avg_page_ms,max_page_ms,full_scan_ms\n";
+    for (size_t n : sizesOr(args, {1000000, 10000000})) {
+        string journalPath = "query-" + to_string(n) + ".journal";
+        auto removeFiles = [&journalPath]() {
+            remove(journalPath.c_str());
+            remove(SegmentCatalog::pathFor(journalPath).c_str());
+            remove(JournalAccountIndex::pathFor(journalPath).c_str());
+            remove(SegmentArchive::pathFor(journalPath).c_str());
+        };
+        removeFiles();
+        TransactionJournal& journal = TransactionJournal::shared(journalPath);
+        {
+            const char* types[] = {"Deposit", "Withdrawal", "Transfer"};
+            mt19937 rng(31);
+            string frames;
+            for (size_t i = 0; i < n; i++) {
+                JournalRecord r;
+                r.date = yearStart + static_cast<int64_t>(i * 365 * static_cast<uint64_t>(day) / n);
+                time_t when = static_cast<time_t>(r.date);
+                bool zakat = gmtime(&when)->tm_mday == 1 && rng() % 100 == 0;
+                r.fromAccount = syntheticAccountNumber(rng() % accounts);
+                r.toAccount = zakat ? "Bank" : syntheticAccountNumber(rng() % accounts);
+                r.amount = Money::fromMinor(1 + rng() % 10000000).toDouble();
+                r.status = rng() % 50 ? "Completed" : "Failed";
+                r.transactionType = zakat ? "Zakat" : types[rng() % 3];
+                TransactionJournal::encode(r, frames);
+                if ((i + 1) % batchRecords == 0 || i + 1 == n) {
+                    journal.appendEncoded(frames);
+                    frames.clear();
+                }
+            }
+        }
+
+        vector<pair<string, TransactionFilter>> filters(5);
+        filters[0].first = "all";
+        filters[1].first = "account";
+        filters[1].second.account = syntheticAccountNumber(4242);
+        filters[2].first = "type_zakat";
+        filters[2].second.transactionType = "Zakat";
+        filters[3].first = "failed_over_50k";
+        filters[3].second.status = "Failed";
+        filters[3].second.minAmount = Money(50000);
+        filters[4].first = "one_week";
+        filters[4].second.from = yearStart + 100 * day;
+        filters[4].second.to = filters[4].second.from + 7 * day - 1;
+
+        for (const auto& named : filters) {
+            const TransactionFilter& filter = named.second;
+            auto start = Clock::now();
+            vector<uint64_t> expected;     // dates and amounts of the matches, oldest first
+            TransactionJournal::forEach(journalPath, [&](const JournalRecord& r, uint64_t) {
+                if (matchesFilter(filter, r)) expected.push_back(static_cast<uint64_t>(r.date) * 31 + Money::fromDouble(r.amount).minorUnits());
+                return true;
+            });
+            double scanMs = elapsedMs(start);
+
+            // The first page alone, then every page (at most 500 of them) through the cursor
+            start = Clock::now();
+            queryTransactions(journalPath, filter, firstPage, pageSize, [](const JournalRecord&) {});
+            double firstMs = elapsedMs(start);
+
+            vector<uint64_t> got;
+            uint64_t cursor = firstPage;
+            size_t pages = 0;
+            double totalMs = 0, maxMs = 0;
+            bool more = true;
+            while (more && pages < 500) {
+                start = Clock::now();
+                TransactionPage page = queryTransactions(journalPath, filter, cursor, pageSize, [&](const JournalRecord& r) {
+                    got.push_back(static_cast<uint64_t>(r.date) * 31 + Money::fromDouble(r.amount).minorUnits());
+                });
+                double ms = elapsedMs(start);
+                totalMs += ms;
+                maxMs = max(maxMs, ms);
+                pages++;
+                more = page.more;
+                cursor = page.next;
+            }
+            reverse(expected.begin(), expected.end());
+            expected.resize(min(expected.size(), got.size() + (more ? 1 : 0)));
+            if (more) expected.pop_back();
+            if (got != expected) throw Exceptions::TransactionException("Paged query disagrees with the full scan");
+
+            cout << n << "," << named.first << "," << got.size() << (more ? "+" : "") << "," << firstMs << ","
+                 << pages << "," << totalMs / pages << "," << maxMs << "," << scanMs << "\n";
+        }
+        removeFiles();
+    }
+}
+
+// Cold history in the columnar archive: n records over a year, the first 335 days
+// archived. Size against the journal and against the pretty-printed JSON the history
+// used to be kept in (json_mb extrapolated from 10000 records), then an amount-only
+// sum over the archived days (amount column alone vs. decoding whole records vs. the
+// journal itself) and a 30-day range scan from the archive vs. the journal.
+void benchArchive(const vector<size_t>& args)
+{
+    const size_t batchRecords = 4096;
+    const int64_t yearStart = 1735689600;     // 2025-01-01 00:00 UTC
+    const int64_t day = SegmentCatalog::segmentSeconds;
+    cout << "records,archived_segments,archive_ms,journal_mb,archive_mb,json_mb,sum_column_ms,sum_records_ms,"
+            "sum_journal_ms,range_archive_ms,range_journal_ms\n";
+    for (size_t n : sizesOr(args, {1000000, 10000000})) {
+        string journalPath = "archive-" + to_string(n) + ".journal";
+        auto removeFiles = [&journalPath]() {
+            remove(journalPath.c_str());
+            remove(SegmentCatalog::pathFor(journalPath).c_str());
+            remove(JournalAccountIndex::pathFor(journalPath).c_str());
+            remove(SegmentArchive::pathFor(journalPath).c_str());
+        };
+        removeFiles();
+        TransactionJournal& journal = TransactionJournal::shared(journalPath);
+
+        const char* types[] = {"Deposit", "Withdrawal", "Transfer", "Salary", "Interest"};
+        mt19937 rng(29);
+        string frames;
+        size_t jsonBytes = 0;
+        for (size_t i = 0; i < n; i++) {
+            JournalRecord r;
+            r.fromAccount = syntheticAccountNumber(rng() % 100000);
+            r.toAccount = syntheticAccountNumber(rng() % 100000);
+            r.amount = Money::fromMinor(1 + rng() % 10000000).toDouble();
+            r.status = rng() % 50 ? "Completed" : "Failed";
+            r.transactionType = types[rng() % 5];
+            r.date = yearStart + static_cast<int64_t>(i * 365 * static_cast<uint64_t>(day) / n);
+            TransactionJournal::encode(r, frames);
+            if (i < 10000) {
+                jsonBytes += json{{"fromAccount", r.fromAccount}, {"toAccount", r.toAccount}, {"amount", r.amount},
+                                  {"status", r.status}, {"transactionType", r.transactionType},
+                                  {"date", r.date}}.dump(4).size() + 6;
+            }
+            if ((i + 1) % batchRecords == 0 || i + 1 == n) {
+                journal.appendEncoded(frames);
+                frames.clear();
+            }
+        }
+        double jsonMb = jsonBytes * (static_cast<double>(n) / min<size_t>(n, 10000)) / 1048576.0;
+
+        int64_t cutoff = yearStart + 335 * day;
+        auto start = Clock::now();
+        JournalArchiveSummary archived = journal.archiveSegments(cutoff);
+        double archiveMs = elapsedMs(start);
+        const SegmentArchive& archive = journal.segmentArchive();
+
+        start = Clock::now();
+        int64_t columnSum = 0;
+        for (size_t b = 0; b < archive.size(); b++) {
+            for (int64_t minor : archive.amounts(b)) columnSum += minor;
+        }
+        double columnMs = elapsedMs(start);
+
+        start = Clock::now();
+        Money recordSum;
+        for (size_t b = 0; b < archive.size(); b++) {
+            archive.forEach(b, [&recordSum](const JournalRecord& r, uint64_t) {
+                recordSum += Money::fromDouble(r.amount);
+                return true;
+            });
+        }
+        double recordsMs = elapsedMs(start);
+
+        start = Clock::now();
+        Money journalSum;
+        uint64_t archivedEnd = archive.size() ? archive.at(archive.size() - 1).journalEnd : 0;
+        TransactionJournal::forEach(journalPath, [&](const JournalRecord& r, uint64_t offset) {
+            if (offset >= archivedEnd) return false;
+            journalSum += Money::fromDouble(r.amount);
+            return true;
+        });
+        double journalMs = elapsedMs(start);
+        if (columnSum != recordSum.minorUnits() || columnSum != journalSum.minorUnits()) {
+            throw Exceptions::TransactionException("Archived amounts disagree with the journal");
+        }
+
+        // The same 30 days from the archive and from the journal, seeking with its time index
+        int64_t from = yearStart + 200 * day, to = from + 30 * day - 1;
+        size_t fromArchive = 0, fromJournal = 0;
+        start = Clock::now();
+        JournalRangeScan scan = journal.forEachInRange(from, to, [&](const JournalRecord& r, uint64_t offset) {
+            fromArchive += offset ^ static_cast<uint64_t>(r.date) ^ r.fromAccount.size();
+            return true;
+        });
+        double rangeArchiveMs = elapsedMs(start);
+        start = Clock::now();
+        TransactionJournal::forEach(journalPath, [&](const JournalRecord& r, uint64_t offset) {
+            if (r.date >= from && r.date <= to) fromJournal += offset ^ static_cast<uint64_t>(r.date) ^ r.fromAccount.size();
+            return r.date <= to;
+        }, journal.seekAfter(from - 1));
+        double rangeJournalMs = elapsedMs(start);
+        if (fromArchive != fromJournal || scan.archived != 30) {
+            throw Exceptions::TransactionException("Archived range scan disagrees with the journal");
+        }
+
+        struct stat st;
+        stat(SegmentArchive::pathFor(journalPath).c_str(), &st);
+        cout << n << "," << archived.segments << "," << archiveMs << "," << journal.size() / 1048576.0 << ","
+             << st.st_size / 1048576.0 << "," << jsonMb << "," << columnMs << "," << recordsMs << "," << journalMs
+             << "," << rangeArchiveMs << "," << rangeJournalMs << "\n";
+        removeFiles();
+    }
+}
+
+// Date-range scans over a year of journal: segments pruned by their footers vs a full scan
+void benchSegments(const vector<size_t>& args)
+{
+    const size_t batchRecords = 4096;
+    const int64_t yearStart = 1735689600;     // 2025-01-01 00:00 UTC
+    const int64_t day = SegmentCatalog::segmentSeconds;
+    const size_t readers = 4;
+    cout << "records,segments,append_ms,range_days,range_records,pruned_ms,segments_read,full_scan_ms,"
+            "shared_readers_ms\n";
+    for (size_t n : sizesOr(args, {1000000, 10000000})) {
+        string journalPath = "segments-" + to_string(n) + ".journal";
+        remove(journalPath.c_str());
+        remove(SegmentCatalog::pathFor(journalPath).c_str());
+        remove(JournalAccountIndex::pathFor(journalPath).c_str());
+        TransactionJournal& journal = TransactionJournal::shared(journalPath);
+
+        const char* types[] = {"Deposit", "Withdrawal", "Transfer", "Salary", "Interest"};
+        mt19937 rng(23);
+        string frames;
+        auto start = Clock::now();
+        for (size_t i = 0; i < n; i++) {
+            JournalRecord r;
+            r.fromAccount = syntheticAccountNumber(rng() % 10000);
+            r.toAccount = syntheticAccountNumber(rng() % 10000);
+            r.amount = (1 + rng() % 100000) / 100.0;
+            r.status = "Completed";
+            r.transactionType = types[rng() % 5];
+            r.date = yearStart + static_cast<int64_t>(i * 365 * static_cast<uint64_t>(day) / n);
+            TransactionJournal::encode(r, frames);
+            if ((i + 1) % batchRecords == 0 || i + 1 == n) {
+                journal.appendEncoded(frames);
+                frames.clear();
+            }
+        }
+        double appendMs = elapsedMs(start);
+
+        vector<SegmentFooter> sealed = journal.segments();
+        for (const SegmentFooter& footer : sealed) {
+            uint64_t typed = 0;
+            for (uint64_t count : footer.typeCounts) typed += count;
+            if (typed != footer.count) throw Exceptions::TransactionException("Segment type counts disagree");
+        }
+
+        for (int64_t days : {1, 7, 30}) {
+            int64_t from = yearStart + 200 * day;
+            int64_t to = from + days * day - 1;
+            auto inRange = [&](const JournalRecord& r) { return r.date >= from && r.date <= to; };
+
+            start = Clock::now();
+            size_t pruned = 0;
+            JournalRangeScan scan = journal.forEachInRange(from, to, [&](const JournalRecord& r, uint64_t) {
+                pruned += inRange(r);
+                return true;
+            });
+            double prunedMs = elapsedMs(start);
+
+            start = Clock::now();
+            size_t scanned = 0;
+            TransactionJournal::forEach(journalPath, [&](const JournalRecord& r, uint64_t) {
+                scanned += inRange(r);
+                return true;
+            });
+            double scanMs = elapsedMs(start);
+            if (pruned != scanned || scan.records != scanned) {
+                throw Exceptions::TransactionException("Pruned scan disagrees with the full scan");
+            }
+
+            // Several threads scanning the same range read the same mappings
+            start = Clock::now();
+            vector<thread> pool;
+            atomic<size_t> total(0);
+            for (size_t t = 0; t < readers; t++) {
+                pool.emplace_back([&]() {
+                    size_t mine = 0;
+                    journal.forEachInRange(from, to, [&](const JournalRecord&, uint64_t) {
+                        mine++;
+                        return true;
+                    });
+                    total += mine;
+                });
+            }
+            for (auto& t : pool) t.join();
+            double sharedMs = elapsedMs(start);
+            if (total != scanned * readers) {
+                throw Exceptions::TransactionException("Concurrent range scans disagree");
+            }
+
+            cout << n << "," << sealed.size() << "," << appendMs << "," << days << "," << scanned << ","
+                 << prunedMs << "," << scan.segments << "," << scanMs << "," << sharedMs << "\n";
+        }
+        remove(journalPath.c_str());
+        remove(SegmentCatalog::pathFor(journalPath).c_str());
+        remove(JournalAccountIndex::pathFor(journalPath).c_str());
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const map<string, function<void(const vector<size_t>&)>> benchmarks = {
+        {"archive", benchArchive},
+        {"asof", benchAsOf},
+        {"load", benchLoad},
+        {"batch", benchBatch},
+        {"credit", benchCredit},
+        {"history", benchHistory},
+        {"index", benchIndex},
+        {"interest", benchInterest},
+        {"journal", benchJournal},
+        {"money", benchMoney},
+        {"netting", benchNetting},
+        {"payroll", benchPayroll},
+        {"query", benchQuery},
+        {"reconcile", benchReconcile},
+        {"scan", benchScan},
+        {"segments", benchSegments},
+        {"snapshot", benchSnapshot},
+        {"statements", benchStatements},
+        {"threads", benchThreads},
+        {"transfer", benchTransfer},
+        {"zakat", benchZakat},
+    };
+
+    string name = argc > 1 ? argv[1] : "all";
+    vector<size_t> sizes;
+    for (int i = 2; i < argc; i++) {
+        sizes.push_back(static_cast<size_t>(stoull(argv[i])));
+    }
+
+    try {
+        string dir = enterScratchDir();
+        cout << "Scratch directory: " << dir << "\n";
+        for (const auto& bench : benchmarks) {
+            if (name == "all" || name == bench.first) {
+                cout << "\n== " << bench.first << " ==\n";
+                bench.second(sizes);
+            }
+        }
+    } catch (const exception& e) {
+        cerr << "Benchmark failed: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,275 @@
+// ----------------------------Balance checkpoint implementation--------------------------------
+
+#include "bank.h"
+#include "checkpoint.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Banking;
+using namespace Banking::Exceptions;
+
+namespace
+{
+    const char checkpointMagic[8] = {'M', 'D', 'B', 'C', 'K', 'P', 'T', '\0'};
+
+    uint32_t headerChecksum(const CheckpointHeader& header)
+    {
+        return TransactionJournal::checksum(reinterpret_cast<const char*>(&header),
+                                            offsetof(CheckpointHeader, checksum));
+    }
+
+    bool readAt(int fd, void* out, size_t length, uint64_t offset)
+    {
+        char* p = static_cast<char*>(out);
+        while (length > 0) {
+            ssize_t n = pread(fd, p, length, static_cast<off_t>(offset));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            p += n;
+            offset += static_cast<uint64_t>(n);
+            length -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    void writeAll(int fd, const char* data, size_t length, const string& path)
+    {
+        while (length > 0) {
+            ssize_t n = ::write(fd, data, length);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw FileException("Write to " + path + " failed: " + strerror(errno));
+            }
+            data += n;
+            length -= static_cast<size_t>(n);
+        }
+    }
+
+    // Net movement of accNum over the journal records in [from, to)
+    Money movements(const string& journalPath, const string& accNum, uint64_t from, uint64_t to, size_t& records)
+    {
+        Money net;
+        if (from >= to) return net;
+        TransactionJournal::forEach(journalPath, [&](const JournalRecord& r, uint64_t offset) {
+            if (offset >= to) return false;
+            records++;
+            if (r.status != "Completed" || r.fromAccount == r.toAccount) return true;
+            if (r.toAccount == accNum) net += Money::fromDouble(r.amount);
+            else if (r.fromAccount == accNum) net -= Money::fromDouble(r.amount);
+            return true;
+        }, from);
+        return net;
+    }
+}
+
+CheckpointLog::CheckpointLog(const string& logPath)
+    : path(logPath), fd(-1), endOffset(0)
+{
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw FileException("Failed to open checkpoint log: " + path);
+    }
+    struct stat st;
+    uint64_t fileSize = fstat(fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+
+    // Headers are checked all the way; the entries only of the last checkpoint, the one
+    // a crash can have cut short
+    CheckpointHeader header;
+    while (endOffset + sizeof(header) <= fileSize && readAt(fd, &header, sizeof(header), endOffset)) {
+        uint64_t blockSize = sizeof(header) + header.count * sizeof(CheckpointEntry);
+        bool valid = memcmp(header.magic, checkpointMagic, sizeof(checkpointMagic)) == 0
+            && header.version == checkpointVersion
+            && header.checksum == headerChecksum(header)
+            && header.count <= (fileSize - endOffset) / sizeof(CheckpointEntry)
+            && endOffset + blockSize <= fileSize
+            && (directory.empty() || header.journalOffset >= directory.back().journalOffset);
+        if (!valid) break;
+
+        CheckpointInfo info;
+        info.fileOffset = endOffset;
+        info.journalOffset = header.journalOffset;
+        info.createdAt = header.createdAt;
+        info.count = header.count;
+        info.full = header.full != 0;
+        directory.push_back(info);
+        endOffset += blockSize;
+    }
+    if (!directory.empty()) {
+        const CheckpointInfo& last = directory.back();
+        string entries(last.count * sizeof(CheckpointEntry), '\0');
+        readAt(fd, &header, sizeof(header), last.fileOffset);
+        if (!readAt(fd, &entries[0], entries.size(), last.fileOffset + sizeof(header))
+            || TransactionJournal::checksum(entries.data(), entries.size()) != header.entriesChecksum) {
+            endOffset = last.fileOffset;
+            directory.pop_back();
+        }
+    }
+    if (fileSize > endOffset && ftruncate(fd, static_cast<off_t>(endOffset)) != 0) {
+        throw FileException("Failed to truncate checkpoint log: " + path);
+    }
+}
+
+CheckpointLog::~CheckpointLog()
+{
+    if (fd >= 0) ::close(fd);
+}
+
+void CheckpointLog::append(uint64_t journalOffset, bool full, vector<CheckpointEntry>& entries, bool syncNow)
+{
+    sort(entries.begin(), entries.end(), [](const CheckpointEntry& a, const CheckpointEntry& b) {
+        return memcmp(a.accountNumber, b.accountNumber, snapshotAccountNumberSize) < 0;
+    });
+
+    CheckpointHeader header = {};
+    memcpy(header.magic, checkpointMagic, sizeof(checkpointMagic));
+    header.version = checkpointVersion;
+    header.full = full ? 1 : 0;
+    header.journalOffset = journalOffset;
+    header.createdAt = static_cast<int64_t>(time(nullptr));
+    header.count = entries.size();
+    header.entriesChecksum = TransactionJournal::checksum(reinterpret_cast<const char*>(entries.data()),
+                                                          entries.size() * sizeof(CheckpointEntry));
+    header.checksum = headerChecksum(header);
+
+    string buffer(reinterpret_cast<const char*>(&header), sizeof(header));
+    buffer.append(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(CheckpointEntry));
+    writeAll(fd, buffer.data(), buffer.size(), path);
+    if (syncNow && fdatasync(fd) != 0) {
+        throw FileException("Failed to sync checkpoint log: " + path);
+    }
+
+    CheckpointInfo info;
+    info.fileOffset = endOffset;
+    info.journalOffset = journalOffset;
+    info.createdAt = header.createdAt;
+    info.count = header.count;
+    info.full = full;
+    lock_guard<mutex> lock(directoryMutex);
+    directory.push_back(info);
+    endOffset += buffer.size();
+}
+
+size_t CheckpointLog::size() const
+{
+    lock_guard<mutex> lock(directoryMutex);
+    return directory.size();
+}
+
+CheckpointInfo CheckpointLog::at(size_t i) const
+{
+    lock_guard<mutex> lock(directoryMutex);
+    return directory.at(i);
+}
+
+long CheckpointLog::lastAtOrBefore(uint64_t journalOffset) const
+{
+    lock_guard<mutex> lock(directoryMutex);
+    auto it = upper_bound(directory.begin(), directory.end(), journalOffset,
+                          [](uint64_t offset, const CheckpointInfo& info) { return offset < info.journalOffset; });
+    return static_cast<long>(it - directory.begin()) - 1;
+}
+
+bool CheckpointLog::find(size_t i, const string& accNum, Money& balance) const
+{
+    if (accNum.size() >= snapshotAccountNumberSize) return false;
+    char key[snapshotAccountNumberSize] = {};
+    memcpy(key, accNum.data(), accNum.size());
+
+    CheckpointInfo info = at(i);
+    uint64_t first = info.fileOffset + sizeof(CheckpointHeader);
+    size_t lo = 0;
+    size_t hi = info.count;
+    CheckpointEntry entry;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (!readAt(fd, &entry, sizeof(entry), first + mid * sizeof(entry))) {
+            throw FileException("Failed to read checkpoint log: " + path);
+        }
+        int cmp = memcmp(entry.accountNumber, key, snapshotAccountNumberSize);
+        if (cmp == 0) {
+            balance = Money::fromMinor(entry.balance);
+            return true;
+        }
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return false;
+}
+
+bool CheckpointLog::balanceAt(size_t i, const string& accNum, Money& balance) const
+{
+    for (size_t j = i + 1; j-- > 0;) {
+        if (find(j, accNum, balance)) return true;
+        if (at(j).full) return false;
+    }
+    return false;
+}
+
+string CheckpointLog::pathFor(const string& journalPath)
+{
+    const string suffix = ".journal";
+    if (journalPath.size() > suffix.size() &&
+        journalPath.compare(journalPath.size() - suffix.size(), suffix.size(), suffix) == 0) {
+        return journalPath.substr(0, journalPath.size() - suffix.size()) + ".checkpoints";
+    }
+    return journalPath + ".checkpoints";
+}
+
+bool Banking::balanceFromCheckpoints(const string& journalPath, const CheckpointLog& log,
+                                     const string& accNum, int64_t when, uint64_t journalEnd,
+                                     HistoricalBalance& result)
+{
+    result = HistoricalBalance();
+
+    // The point in the journal that stands for the time: its first record dated later
+    uint64_t start = min(TransactionJournal::shared(journalPath).seekAfter(when), journalEnd);
+    result.boundary = journalEnd;
+    TransactionJournal::forEach(journalPath, [&](const JournalRecord& r, uint64_t offset) {
+        if (offset >= journalEnd) return false;
+        result.replayedRecords++;
+        if (r.date <= when) return true;
+        result.boundary = offset;
+        return false;
+    }, start);
+
+    // Forward from the last checkpoint at or before that point
+    long last = log.lastAtOrBefore(result.boundary);
+    Money balance;
+    if (last >= 0 && log.balanceAt(static_cast<size_t>(last), accNum, balance)) {
+        result.checkpoint = last;
+        result.balance = balance + movements(journalPath, accNum, log.at(last).journalOffset,
+                                             result.boundary, result.replayedRecords);
+        return true;
+    }
+
+    // The account did not exist yet at that checkpoint: back from the next one, which
+    // lists it if it was opened in between
+    size_t next = static_cast<size_t>(last + 1);
+    if (next < log.size() && log.at(next).journalOffset <= journalEnd) {
+        if (!log.find(next, accNum, balance)) {
+            result.existed = false;
+            return true;
+        }
+        result.checkpoint = static_cast<long>(next);
+        result.forward = false;
+        result.balance = balance - movements(journalPath, accNum, result.boundary,
+                                             log.at(next).journalOffset, result.replayedRecords);
+        return true;
+    }
+    return false;
+}
+
+HistoricalBalance Banking::balanceAsOf(const string& journalPath, const CheckpointLog& log,
+                                       const string& accNum, int64_t when, Money live, uint64_t journalEnd)
+{
+    HistoricalBalance result;
+    if (balanceFromCheckpoints(journalPath, log, accNum, when, journalEnd, result)) return result;
+
+    // Or back from the live balance when no checkpoint follows
+    result.forward = false;
+    result.balance = live - movements(journalPath, accNum, result.boundary, journalEnd, result.replayedRecords);
+    return result;
+}
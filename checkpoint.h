@@ -0,0 +1,119 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "money.h"
+#include "snapshot.h"
+
+// ----------------------------Balance checkpoints--------------------------------
+//
+// Balances of the accounts at points in the journal's history, so the balance an
+// account had at any time is rebuilt from the nearest checkpoint and a short stretch of
+// journal instead of the whole history. The log is append-only (host byte order):
+//
+//     CheckpointHeader  CheckpointEntry[count] (sorted by account number)  ...
+//
+// A checkpoint holds the balance of every listed account once the journal reached
+// journalOffset. A full checkpoint lists every account; the others list only the
+// accounts that changed since the checkpoint before, so an account missing from one
+// still had the balance of the nearest earlier checkpoint that lists it (searching no
+// further back than a full checkpoint). Each header carries a CRC-32 of itself and one
+// of its entries; a checkpoint cut short by a crash fails them and is truncated on open.
+
+namespace Banking
+{
+    const uint32_t checkpointVersion = 1;
+    const size_t fullCheckpointEvery = 64;      // every 64th checkpoint lists every account
+
+    struct CheckpointHeader
+    {
+        char magic[8];              // "MDBCKPT"
+        uint32_t version;
+        uint32_t full;              // 1 when every account is listed
+        uint64_t journalOffset;
+        int64_t createdAt;
+        uint64_t count;
+        uint32_t entriesChecksum;   // CRC-32 of the entries
+        uint32_t checksum;          // CRC-32 of every header byte before this field
+    };
+
+    struct CheckpointEntry
+    {
+        char accountNumber[snapshotAccountNumberSize];   // NUL padded
+        int64_t balance;            // minor units
+    };
+
+    struct CheckpointInfo
+    {
+        uint64_t fileOffset = 0;    // where the header starts
+        uint64_t journalOffset = 0;
+        int64_t createdAt = 0;
+        uint64_t count = 0;
+        bool full = false;
+    };
+
+    class CheckpointLog
+    {
+    private:
+        std::string path;
+        int fd;
+        uint64_t endOffset;
+        mutable std::mutex directoryMutex;
+        std::vector<CheckpointInfo> directory;      // ascending journalOffset
+
+    public:
+        // Opens (or creates) the log and truncates a torn checkpoint at the tail
+        explicit CheckpointLog(const std::string& logPath);
+        ~CheckpointLog();
+
+        CheckpointLog(const CheckpointLog&) = delete;
+        CheckpointLog& operator=(const CheckpointLog&) = delete;
+
+        // Append one checkpoint (entries are sorted here). Thread-safe against readers;
+        // appends themselves must not overlap.
+        void append(uint64_t journalOffset, bool full, std::vector<CheckpointEntry>& entries, bool syncNow);
+
+        size_t size() const;
+        CheckpointInfo at(size_t i) const;
+        // Index of the last checkpoint taken at or before journalOffset, -1 when none
+        long lastAtOrBefore(uint64_t journalOffset) const;
+
+        // Balance of accNum listed in checkpoint i, false when it is not listed
+        bool find(size_t i, const std::string& accNum, Money& balance) const;
+        // Balance accNum had at checkpoint i (listed there or in an earlier checkpoint
+        // back to the last full one), false when it did not exist then
+        bool balanceAt(size_t i, const std::string& accNum, Money& balance) const;
+
+        // Log path that belongs to a journal (transactions.journal -> transactions.checkpoints)
+        static std::string pathFor(const std::string& journalPath);
+    };
+
+    struct HistoricalBalance
+    {
+        Money balance;
+        bool existed = true;            // false when the account was opened later
+        long checkpoint = -1;           // checkpoint replayed from, -1 for the live balance
+        bool forward = true;            // replayed forward from the checkpoint (else back)
+        uint64_t boundary = 0;          // journal offset of the first record dated after the time
+        size_t replayedRecords = 0;     // journal records read to get there
+    };
+
+    // Balance accNum had at time when: every journal record dated up to then counted,
+    // none after it. Starts from the checkpoint nearest to that point in the journal (or
+    // from live, the balance the account had when the journal ended at journalEnd) and
+    // replays the journal between the two, at most one checkpoint interval.
+    HistoricalBalance balanceAsOf(const std::string& journalPath, const CheckpointLog& log,
+                                  const std::string& accNum, int64_t when, Money live, uint64_t journalEnd);
+    // Same from the checkpoints alone, false when no checkpoint around that point lists
+    // the account so that only the live balance could answer (out then holds the boundary
+    // and the records read so far)
+    bool balanceFromCheckpoints(const std::string& journalPath, const CheckpointLog& log,
+                                const std::string& accNum, int64_t when, uint64_t journalEnd,
+                                HistoricalBalance& out);
+}
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,96 @@
+// ----------------------------Cold customer data implementation--------------------------------
+
+#include "bank.h"
+#include "customer_store.h"
+
+using namespace Banking;
+
+CustomerStore::CustomerStore() : loaded(0)
+{
+}
+
+CustomerStore::~CustomerStore()
+{
+}
+
+void CustomerStore::ensureRow(uint32_t row)
+{
+    if (row >= infos.size()) {
+        infos.resize(row + 1);
+        snapshotRows.resize(row + 1, -1);
+    }
+}
+
+void CustomerStore::set(uint32_t row, const PersonalInfo& info)
+{
+    lock_guard<mutex> guard(lock);
+    ensureRow(row);
+    if (!infos[row]) {
+        infos[row].reset(new PersonalInfo(info));
+        loaded++;
+    } else {
+        *infos[row] = info;
+    }
+    snapshotRows[row] = -1;
+}
+
+void CustomerStore::setLazy(uint32_t row, int64_t snapshotIndex)
+{
+    lock_guard<mutex> guard(lock);
+    ensureRow(row);
+    if (infos[row]) {
+        infos[row].reset();
+        loaded--;
+    }
+    snapshotRows[row] = snapshotIndex;
+}
+
+PersonalInfo CustomerStore::get(uint32_t row)
+{
+    lock_guard<mutex> guard(lock);
+    ensureRow(row);
+    if (!infos[row]) {
+        PersonalInfo* info = new PersonalInfo();
+        int64_t index = snapshotRows[row];
+        if (index >= 0 && snapshot) {
+            size_t i = static_cast<size_t>(index);
+            info->name = string(snapshot->field(i, SnapshotName));
+            info->dob = string(snapshot->field(i, SnapshotDob));
+            info->cnic = string(snapshot->field(i, SnapshotCnic));
+            info->address = string(snapshot->field(i, SnapshotAddress));
+            info->openingDate = static_cast<time_t>(snapshot->record(i).openingDate);
+        } else {
+            info->openingDate = time(nullptr);
+        }
+        infos[row].reset(info);
+        snapshotRows[row] = -1;
+        loaded++;
+    }
+    return *infos[row];
+}
+
+void CustomerStore::erase(uint32_t row)
+{
+    lock_guard<mutex> guard(lock);
+    if (row >= infos.size()) return;
+    if (infos[row]) {
+        infos[row].reset();
+        loaded--;
+    }
+    snapshotRows[row] = -1;
+}
+
+void CustomerStore::clear()
+{
+    lock_guard<mutex> guard(lock);
+    infos.clear();
+    snapshotRows.clear();
+    snapshot.reset();
+    loaded = 0;
+}
+
+void CustomerStore::attachSnapshot(shared_ptr<AccountSnapshot> snap)
+{
+    lock_guard<mutex> guard(lock);
+    snapshot = move(snap);
+}
@@ -0,0 +1,61 @@
+#ifndef CUSTOMER_STORE_H
+#define CUSTOMER_STORE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// ----------------------------Cold customer data--------------------------------
+//
+// PersonalInfo (name, dob, cnic, address) is only needed to display or export an
+// account, never for balance work, so it is kept out of the account objects and the
+// hot columns. Entries are addressed by the account's row in the AccountStore. Rows
+// that came from a binary snapshot are not materialized at load time: they keep the
+// snapshot record index and are read from the mapped file on first access. All
+// members are thread-safe.
+
+namespace Banking
+{
+    struct PersonalInfo;
+    class AccountSnapshot;
+
+    class CustomerStore
+    {
+    private:
+        std::vector<std::unique_ptr<PersonalInfo>> infos;   // by row, null until loaded
+        std::vector<int64_t> snapshotRows;                  // by row, -1 when not lazy
+        std::shared_ptr<AccountSnapshot> snapshot;
+        size_t loaded;
+        std::mutex lock;                                    // lazy loads may run on several threads
+
+        void ensureRow(uint32_t row);
+
+    public:
+        CustomerStore();
+        ~CustomerStore();
+
+        CustomerStore(const CustomerStore&) = delete;
+        CustomerStore& operator=(const CustomerStore&) = delete;
+
+        void set(uint32_t row, const PersonalInfo& info);
+
+        // Defer loading of a row to the first get(): the data is record snapshotIndex
+        // of the attached snapshot
+        void setLazy(uint32_t row, int64_t snapshotIndex);
+
+        // Copy of the PersonalInfo of a row, reading it from the snapshot on first use.
+        // Copied under the lock, since set() may replace the entry right after.
+        PersonalInfo get(uint32_t row);
+
+        void erase(uint32_t row);
+        void clear();
+
+        // Keep a mapped snapshot alive for lazy rows
+        void attachSnapshot(std::shared_ptr<AccountSnapshot> snap);
+
+        size_t loadedCount() const { return loaded; }
+    };
+}
+
+#endif // CUSTOMER_STORE_H
@@ -0,0 +1,157 @@
+#ifndef INTEREST_H
+#define INTEREST_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "money.h"
+
+// ----------------------------Daily interest accrual--------------------------------
+//
+// Saving accounts earn a yearly rate, credited once per day as
+//
+//     balance * annualRateBp / (10000 * daysPerYear)     rounded once with the schedule's policy
+//
+// The rate comes from the highest tier whose minimum the whole balance reaches. Days
+// are counted from the Unix epoch in local time; every account remembers the last day
+// it was credited, which is what makes a run safe to repeat or resume after a crash.
+
+namespace Banking
+{
+    template<typename B>
+    struct InterestTier
+    {
+        B minBalance;
+        int64_t annualRateBp;       // basis points per year, 350 = 3.5%
+    };
+
+    template<typename B>
+    struct InterestSchedule
+    {
+        std::vector<InterestTier<B>> tiers;     // ascending minBalance
+        int64_t daysPerYear = 365;
+        Rounding rounding = Rounding::HalfEven;
+
+        // 0% below 10000, 3% from 10000, 4% from 100000, 5% from 1000000
+        static InterestSchedule standard()
+        {
+            InterestSchedule schedule;
+            schedule.tiers = {{B(0), 0}, {B(10000), 300}, {B(100000), 400}, {B(1000000), 500}};
+            return schedule;
+        }
+
+        // Throws std::invalid_argument unless tiers ascend and rates are not negative
+        void validate() const
+        {
+            if (daysPerYear <= 0) throw std::invalid_argument("daysPerYear must be positive");
+            for (size_t k = 0; k < tiers.size(); k++) {
+                if (tiers[k].annualRateBp < 0) throw std::invalid_argument("Interest rates cannot be negative");
+                if (k > 0 && !(tiers[k - 1].minBalance < tiers[k].minBalance)) {
+                    throw std::invalid_argument("Interest tiers must ascend by minBalance");
+                }
+            }
+        }
+    };
+
+    namespace InterestDetail
+    {
+        const size_t blockSize = 512;
+
+        // One block of accrueDailyInterest. The trip count is a constant, so even -O2
+        // vectorizes the floating passes without a scalar epilogue.
+        template<typename B>
+        void accrueBlock(const B* balance, const uint8_t* include, B* out, const InterestSchedule<B>& schedule)
+        {
+            const int64_t den = 10000 * schedule.daysPerYear;
+            if constexpr (std::is_floating_point<B>::value) {
+                // Select the daily factor per tier, then multiply in the local array
+                // (no aliasing to rule out) and copy out
+                B factors[blockSize];
+                for (size_t i = 0; i < blockSize; i++) factors[i] = B();
+                for (const InterestTier<B>& tier : schedule.tiers) {
+                    const B minBalance = tier.minBalance;
+                    const B factor = static_cast<B>(tier.annualRateBp) / static_cast<B>(den);
+                    for (size_t i = 0; i < blockSize; i++) factors[i] = balance[i] >= minBalance ? factor : factors[i];
+                }
+                for (size_t i = 0; i < blockSize; i++) factors[i] = include[i] ? factors[i] : B();
+                for (size_t i = 0; i < blockSize; i++) factors[i] = balance[i] * factors[i];
+                std::copy(factors, factors + blockSize, out);
+            } else {
+                // Exact int64 division has no SIMD form and dominates the cost, so the
+                // rate is picked per row and rows that earn nothing skip the division
+                const InterestTier<B>* tiers = schedule.tiers.data();
+                const size_t tierCount = schedule.tiers.size();
+                for (size_t i = 0; i < blockSize; i++) {
+                    int64_t rate = 0;
+                    for (size_t k = 0; k < tierCount; k++) rate = balance[i] >= tiers[k].minBalance ? tiers[k].annualRateBp : rate;
+                    out[i] = include[i] && rate ? AmountTraits<B>::mulDiv(balance[i], rate, den, schedule.rounding) : B();
+                }
+            }
+        }
+    }
+
+    // Interest for n accounts laid out as plain arrays: due[i] is zero where eligible[i]
+    // is 0. Rows are taken in blocks that stay in L1. Floating balances go through
+    // branch-free passes (one select per tier, then the product AmountTraits::mulDiv
+    // forms), which the compiler vectorizes; Money keeps its exact rounding per row.
+    template<typename B>
+    void accrueDailyInterest(const B* balances, const uint8_t* eligible, B* due,
+                             size_t n, const InterestSchedule<B>& schedule)
+    {
+        using InterestDetail::blockSize;
+        size_t first = 0;
+        for (; first + blockSize <= n; first += blockSize) {
+            InterestDetail::accrueBlock(balances + first, eligible + first, due + first, schedule);
+        }
+        if (first == n) return;
+
+        // Pad the last partial block with ineligible rows
+        const size_t count = n - first;
+        B balance[blockSize] = {};
+        uint8_t include[blockSize] = {};
+        B out[blockSize];
+        std::copy(balances + first, balances + n, balance);
+        std::copy(eligible + first, eligible + n, include);
+        InterestDetail::accrueBlock(balance, include, out, schedule);
+        std::copy(out, out + count, due + first);
+    }
+
+    // Day number (local calendar date) of a point in time; day 0 means "never"
+    inline int32_t accrualDayOf(time_t when)
+    {
+        struct tm local;
+        localtime_r(&when, &local);
+        struct tm utc = {};
+        utc.tm_year = local.tm_year;
+        utc.tm_mon = local.tm_mon;
+        utc.tm_mday = local.tm_mday;
+        return static_cast<int32_t>(timegm(&utc) / 86400);
+    }
+
+    // "YYYY-MM-DD" of a day number
+    inline std::string formatAccrualDay(int32_t day)
+    {
+        time_t at = static_cast<time_t>(day) * 86400;
+        struct tm utc;
+        gmtime_r(&at, &utc);
+        char buffer[16];
+        strftime(buffer, sizeof(buffer), "%Y-%m-%d", &utc);
+        return buffer;
+    }
+
+    // Day number of "YYYY-MM-DD", 0 when the text is not a date
+    inline int32_t parseAccrualDay(const std::string& text)
+    {
+        struct tm utc = {};
+        const char* end = strptime(text.c_str(), "%Y-%m-%d", &utc);
+        if (!end || *end != '\0') return 0;
+        return static_cast<int32_t>(timegm(&utc) / 86400);
+    }
+}
+
+#endif // INTEREST_H
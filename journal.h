@@ -0,0 +1,194 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ----------------------------Append-only transaction journal--------------------------------
+//
+// Every record on disk is framed as
+//
+//     [u32 payload length][u32 CRC-32 of payload][payload]
+//
+// and the payload is
+//
+//     u8 version | i64 date | f64 amount | str from | str to | str status | str type
+//
+// where str is a u16 length followed by the bytes. Integers are stored in host
+// (little-endian) order. Appending never touches earlier records, so a write costs
+// O(record size) no matter how long the history is. A torn record at the tail (crash
+// mid-write) fails its checksum, is ignored by readers and is cut off by the next writer.
+//
+// Records are appended in commit order, so their dates only ever go back by the few
+// moments a record waits in the queue. The journal keeps a sparse time index in memory
+// (built by the scan that opens it, extended on every append): one entry per
+// timeIndexStride bytes holding the latest date of everything before it, which lets a
+// reader seek close to any point in time without reading the history before it.
+// Every append also goes to a per-account index file (see journal_index.h), so the
+// records of one account are read without touching anybody else's, and to the daily
+// segment catalog (see segment.h), so a date-range scan skips the days it cannot match.
+// Cold segments can be copied into a columnar archive (see archive.h), which range
+// scans then read instead of the journal bytes.
+
+namespace Banking
+{
+    struct JournalRecord
+    {
+        std::string fromAccount;
+        std::string toAccount;
+        double amount = 0.0;
+        std::string status;
+        std::string transactionType;
+        int64_t date = 0;
+    };
+
+    struct JournalRangeScan
+    {
+        size_t segments = 0;        // segments read (the open one included)
+        size_t archived = 0;        // ... of them from the archive
+        size_t skipped = 0;         // segments pruned by their dates
+        size_t records = 0;         // records handed to the callback
+    };
+
+    struct JournalArchiveSummary
+    {
+        size_t segments = 0;        // segments archived by this call
+        size_t skipped = 0;         // left to the journal (see SegmentArchive::append)
+        size_t records = 0;
+        uint64_t journalBytes = 0;  // journal bytes of the archived segments
+        uint64_t archiveBytes = 0;  // archive bytes they took
+    };
+
+    class JournalAccountIndex;
+    class SegmentArchive;
+    class SegmentCatalog;
+    class MappedSegment;
+    struct SegmentFooter;
+
+    class TransactionJournal
+    {
+    private:
+        std::string path;
+        int fd;
+        uint64_t endOffset;      // offset where the next record will be written
+        bool tornTail;           // a failed write left bytes past endOffset that are still to be cut
+        mutable std::mutex writeMutex;   // appends from several threads stay whole and ordered
+        std::vector<std::pair<uint64_t, int64_t>> timeIndex;    // (offset, latest date before it)
+        uint64_t nextIndexOffset;        // first offset that gets the next index entry
+        int64_t latestDate;              // latest date of any record so far
+        std::unique_ptr<JournalAccountIndex> accountIndex;     // records by account, under writeMutex
+        std::unique_ptr<SegmentCatalog> segmentCatalog;        // daily segments, under writeMutex
+        mutable std::mutex mappingMutex;
+        mutable std::vector<std::weak_ptr<const MappedSegment>> mappings;  // by segment, while anyone reads it
+        std::unique_ptr<SegmentArchive> archive;
+        std::mutex archiveMutex;         // one archiveSegments at a time
+        size_t nextToArchive;            // sealed segments before it are archived or skipped
+
+        // Note one record in the time index (caller holds writeMutex or is the constructor)
+        void indexRecord(uint64_t offset, int64_t date);
+
+    public:
+        // Opens (or creates) the journal and truncates any torn record at the tail
+        explicit TransactionJournal(const std::string& journalPath);
+        ~TransactionJournal();
+
+        TransactionJournal(const TransactionJournal&) = delete;
+        TransactionJournal& operator=(const TransactionJournal&) = delete;
+
+        // Size of the [length][checksum] header in front of every payload, and the
+        // largest payload a reader accepts (anything longer is corruption)
+        static const size_t frameHeaderSize = 2 * sizeof(uint32_t);
+        static const uint32_t maxPayloadSize = 1u << 20;
+        // Journal bytes between two time index entries
+        static const uint64_t timeIndexStride = 64 << 10;
+
+        // Process-wide journal for a path, opened on first use
+        static TransactionJournal& shared(const std::string& journalPath);
+
+        // Append one record, returns the offset it was written at (thread-safe)
+        uint64_t append(const JournalRecord& record);
+        // Append records already framed by encode with one write call, returns the
+        // offset of the first (thread-safe)
+        uint64_t appendEncoded(const std::string& frames);
+
+        // Flush appended records to stable storage
+        void sync();
+
+        uint64_t size() const
+        {
+            std::lock_guard<std::mutex> lock(writeMutex);
+            return endOffset;
+        }
+        const std::string& getPath() const { return path; }
+
+        // Hand fn every record naming accNum as fromAccount or toAccount, oldest first,
+        // with its offset; with limit, only the newest limit of them. Reads those
+        // records and no others, through the account index. Returns how many fn got.
+        size_t forEachOf(const std::string& accNum, const std::function<void(const JournalRecord&, uint64_t)>& fn,
+                         size_t limit = SIZE_MAX) const;
+        // Read the record at offset, false when no intact record starts there
+        bool readAt(uint64_t offset, JournalRecord& out) const;
+
+        // Backward walks, newest record first. position is where to start (newest, or a
+        // position an earlier walk returned); fn returns false to stop at a record, whose
+        // position is then returned so a later walk starts with it. exhausted is returned
+        // when the walk ran out of records. Positions are only meaningful to the kind of
+        // walk that returned them.
+        static constexpr uint64_t newest = UINT64_MAX;
+        static constexpr uint64_t exhausted = UINT64_MAX - 1;
+        // The records naming accNum, through the account index (positions are index entries)
+        uint64_t walkAccountBackward(const std::string& accNum, uint64_t position,
+                                     const std::function<bool(const JournalRecord&, uint64_t)>& fn) const;
+        // Every record, skipping the segments keep rejects (positions are record offsets).
+        // Holds the frame positions of one segment at a time, never the whole journal.
+        uint64_t walkBackward(uint64_t position, const std::function<bool(const SegmentFooter&)>& keep,
+                              const std::function<bool(const JournalRecord&, uint64_t)>& fn) const;
+
+        // Footers of the sealed segments, oldest first
+        std::vector<SegmentFooter> segments() const;
+        // Read-only mapping of sealed segment i, shared by every reader holding it
+        std::shared_ptr<const MappedSegment> mapSegment(size_t i) const;
+        // Hand fn every record dated in [from, to] with its offset, oldest first, up to
+        // end; fn returns false to stop. Skips the segments dated wholly outside the
+        // range and reads the sealed ones from the archive or through their mappings.
+        JournalRangeScan forEachInRange(int64_t from, int64_t to,
+                                        const std::function<bool(const JournalRecord&, uint64_t)>& fn,
+                                        uint64_t end = UINT64_MAX) const;
+
+        // Copy every sealed segment dated wholly before before into the archive, oldest
+        // first, at most maxSegments of them (thread-safe; appends go on meanwhile)
+        JournalArchiveSummary archiveSegments(int64_t before, size_t maxSegments = SIZE_MAX);
+        const SegmentArchive& segmentArchive() const { return *archive; }
+
+        // Offset to start a scan for the records dated after date: nothing before it is
+        // later than date, and the first such record is at most one index stride past it
+        uint64_t seekAfter(int64_t date) const;
+
+        // Serialize one framed record onto the end of out
+        static void encode(const JournalRecord& record, std::string& out);
+        // Parse one payload (without the frame), false if it is malformed
+        static bool decode(const char* data, size_t length, JournalRecord& out);
+
+        // Stream every valid record starting at startOffset. The callback gets the record
+        // and its offset and returns false to stop early. Returns the offset just past the
+        // last valid record that was read.
+        static uint64_t forEach(const std::string& journalPath,
+                                const std::function<bool(const JournalRecord&, uint64_t)>& fn,
+                                uint64_t startOffset = 0);
+
+        // One-time conversion of a legacy transactions.json array into a journal, all or
+        // nothing; call it before the journal is first opened. Does nothing (returns 0)
+        // when the journal already holds records. A malformed file throws FileException.
+        static size_t importJson(const std::string& jsonPath, const std::string& journalPath);
+
+        // CRC-32 (IEEE) used to checksum payloads
+        static uint32_t checksum(const char* data, size_t length);
+    };
+}
+
+#endif // JOURNAL_H
@@ -0,0 +1,174 @@
+// ----------------------------Per-account journal index implementation--------------------------------
+
+#include "bank.h"
+#include "journal_index.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Banking;
+using namespace Banking::Exceptions;
+
+namespace
+{
+    const size_t entrySize = sizeof(JournalIndexEntry);
+    const size_t entriesPerRead = 1 << 16;
+
+    void writeAll(int fd, const char* data, size_t length, const string& path)
+    {
+        while (length > 0) {
+            ssize_t n = ::write(fd, data, length);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw FileException("Write to " + path + " failed: " + strerror(errno));
+            }
+            data += n;
+            length -= static_cast<size_t>(n);
+        }
+    }
+}
+
+JournalAccountIndex::JournalAccountIndex(const string& indexPath, uint64_t journalEnd)
+    : path(indexPath), fd(-1), entries(0), lastRecord(noRecord), tornTail(false)
+{
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw FileException("Failed to open journal index: " + path);
+    }
+
+    // Keep entries while they chain up correctly and point inside the journal
+    vector<JournalIndexEntry> block(entriesPerRead);
+    bool valid = true;
+    while (valid) {
+        ssize_t n = pread(fd, block.data(), block.size() * entrySize, static_cast<off_t>(entries * entrySize));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < static_cast<ssize_t>(entrySize)) break;
+        size_t count = static_cast<size_t>(n) / entrySize;
+        for (size_t i = 0; i < count; i++) {
+            const JournalIndexEntry& e = block[i];
+            auto slot = heads.try_emplace(e.accountKey, noEntry).first;
+            if (e.recordOffset >= journalEnd || (lastRecord != noRecord && e.recordOffset < lastRecord)
+                || e.previous != slot->second) {
+                if (slot->second == noEntry) heads.erase(slot);
+                valid = false;
+                break;
+            }
+            slot->second = entries++;
+            lastRecord = e.recordOffset;
+        }
+        if (count < block.size()) break;
+    }
+
+    // The newest record's entries may be cut short: drop them and index it again
+    while (entries > 0 && lastRecord != noRecord) {
+        JournalIndexEntry e;
+        if (pread(fd, &e, entrySize, static_cast<off_t>((entries - 1) * entrySize)) != static_cast<ssize_t>(entrySize)
+            || e.recordOffset != lastRecord) {
+            break;
+        }
+        if (e.previous == noEntry) heads.erase(e.accountKey);
+        else heads[e.accountKey] = e.previous;
+        entries--;
+    }
+    if (entries > 0) {
+        JournalIndexEntry e;
+        if (pread(fd, &e, entrySize, static_cast<off_t>((entries - 1) * entrySize)) != static_cast<ssize_t>(entrySize)) {
+            throw FileException("Failed to read journal index: " + path);
+        }
+        lastRecord = e.recordOffset;
+    } else {
+        lastRecord = noRecord;
+    }
+    if (ftruncate(fd, static_cast<off_t>(entries * entrySize)) != 0) {
+        throw FileException("Failed to truncate journal index: " + path);
+    }
+}
+
+JournalAccountIndex::~JournalAccountIndex()
+{
+    if (fd >= 0) ::close(fd);
+}
+
+void JournalAccountIndex::add(uint64_t recordOffset, string_view fromAccount, string_view toAccount)
+{
+    auto link = [this, recordOffset](string_view accNum) {
+        uint64_t key = keyOf(accNum);
+        auto slot = heads.try_emplace(key, noEntry).first;
+        pending.push_back({recordOffset, slot->second, key});
+        slot->second = entries + pending.size() - 1;
+    };
+    if (!fromAccount.empty()) link(fromAccount);
+    if (!toAccount.empty() && toAccount != fromAccount) link(toAccount);
+    lastRecord = recordOffset;
+}
+
+void JournalAccountIndex::flush()
+{
+    if (pending.empty()) return;
+    // Part of an entry left by a failed write would shift every entry after it, so the
+    // file goes back to whole entries before anything is appended
+    if (tornTail && ftruncate(fd, static_cast<off_t>(entries * entrySize)) != 0) {
+        throw FileException("Failed to truncate torn journal index tail: " + path);
+    }
+    tornTail = false;
+    try {
+        writeAll(fd, reinterpret_cast<const char*>(pending.data()), pending.size() * entrySize, path);
+    } catch (const FileException&) {
+        tornTail = ftruncate(fd, static_cast<off_t>(entries * entrySize)) != 0;
+        throw;
+    }
+    entries += pending.size();
+    pending.clear();
+}
+
+uint64_t JournalAccountIndex::head(const string& accNum) const
+{
+    auto it = heads.find(keyOf(accNum));
+    uint64_t entry = it == heads.end() ? noEntry : it->second;
+    // Entries still buffered after a failed flush are not in the file for chain() yet
+    while (entry != noEntry && entry >= entries) entry = pending[entry - entries].previous;
+    return entry;
+}
+
+vector<uint64_t> JournalAccountIndex::chain(uint64_t entry, uint64_t accountKey, size_t limit) const
+{
+    vector<uint64_t> offsets;
+    JournalIndexEntry e;
+    while (entry != noEntry && offsets.size() < limit) {
+        if (pread(fd, &e, entrySize, static_cast<off_t>(entry * entrySize)) != static_cast<ssize_t>(entrySize)
+            || e.accountKey != accountKey) {
+            throw FileException("Journal index is damaged: " + path);
+        }
+        offsets.push_back(e.recordOffset);
+        entry = e.previous;
+    }
+    return offsets;
+}
+
+bool JournalAccountIndex::read(uint64_t entry, JournalIndexEntry& out) const
+{
+    return entry < UINT64_MAX / entrySize
+        && pread(fd, &out, entrySize, static_cast<off_t>(entry * entrySize)) == static_cast<ssize_t>(entrySize);
+}
+
+uint64_t JournalAccountIndex::keyOf(string_view accNum)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : accNum) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+string JournalAccountIndex::pathFor(const string& journalPath)
+{
+    const string suffix = ".journal";
+    if (journalPath.size() > suffix.size() &&
+        journalPath.compare(journalPath.size() - suffix.size(), suffix.size(), suffix) == 0) {
+        return journalPath.substr(0, journalPath.size() - suffix.size()) + ".index";
+    }
+    return journalPath + ".index";
+}
@@ -0,0 +1,85 @@
+#ifndef JOURNAL_INDEX_H
+#define JOURNAL_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// ----------------------------Per-account journal index--------------------------------
+//
+// Finds the journal records that name an account (as fromAccount or toAccount) without
+// reading the others. The index file next to the journal (transactions.journal ->
+// transactions.index) is append-only, one fixed-width entry per account a record names:
+//
+//     u64 record offset | u64 previous entry of the same account | u64 account key
+//
+// so each account's entries form a chain from its newest record back to its oldest, and
+// a query follows its chain: O(records of the account). The key is a 64-bit FNV-1a hash
+// of the account number; readers compare the decoded record with the account, so a
+// collision only lengthens a chain. Only the newest entry of every account (its chain
+// head) is held in memory, rebuilt from the file on open.
+//
+// The index is derived data and is never synced: entries past the journal's end (the
+// journal lost its unsynced tail) are dropped on open, and records the index missed
+// (it lost its tail) are indexed again from the journal.
+
+namespace Banking
+{
+    struct JournalIndexEntry
+    {
+        uint64_t recordOffset;
+        uint64_t previous;      // entry number, noEntry at the oldest record of the account
+        uint64_t accountKey;
+    };
+
+    class JournalAccountIndex
+    {
+    private:
+        std::string path;
+        int fd;
+        uint64_t entries;                               // entries in the file
+        uint64_t lastRecord;                            // offset of the newest indexed record
+        std::unordered_map<uint64_t, uint64_t> heads;   // account key -> newest entry
+        std::vector<JournalIndexEntry> pending;         // added, not yet written
+        bool tornTail;                                  // a failed write left bytes past the entries
+
+    public:
+        static constexpr uint64_t noEntry = UINT64_MAX;
+        static constexpr uint64_t noRecord = UINT64_MAX;
+
+        // Opens (or creates) the index and keeps the entries of the records before
+        // journalEnd. Not thread-safe: the journal serializes every call.
+        JournalAccountIndex(const std::string& indexPath, uint64_t journalEnd);
+        ~JournalAccountIndex();
+
+        JournalAccountIndex(const JournalAccountIndex&) = delete;
+        JournalAccountIndex& operator=(const JournalAccountIndex&) = delete;
+
+        // Offset of the newest record the index covers, noRecord when it is empty
+        uint64_t lastIndexedRecord() const { return lastRecord; }
+
+        // Index the record at recordOffset (records arrive in journal order); buffered
+        // until flush
+        void add(uint64_t recordOffset, std::string_view fromAccount, std::string_view toAccount);
+        // Write buffered entries with one write call. On failure the file is cut back
+        // to the written entries and the buffered ones are kept for the next flush.
+        void flush();
+
+        // Newest written entry of an account, noEntry when it has none
+        uint64_t head(const std::string& accNum) const;
+        // Follow a chain from entry: record offsets, newest first, at most limit of them.
+        // Reads only written entries, so it may run alongside add and flush.
+        std::vector<uint64_t> chain(uint64_t entry, uint64_t accountKey, size_t limit) const;
+        // Read one written entry, false when there is no such entry
+        bool read(uint64_t entry, JournalIndexEntry& out) const;
+
+        static uint64_t keyOf(std::string_view accNum);
+        // Index path that belongs to a journal (transactions.journal -> transactions.index)
+        static std::string pathFor(const std::string& journalPath);
+    };
+}
+
+#endif // JOURNAL_INDEX_H
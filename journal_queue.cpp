@@ -0,0 +1,234 @@
+// ----------------------------Asynchronous journal queue implementation--------------------------------
+
+#include "bank.h"
+#include "journal_queue.h"
+
+using namespace Banking;
+using namespace Banking::Exceptions;
+
+namespace
+{
+    const size_t maxBatchRecords = 4096;     // bounds the writer's buffer and the wait per batch
+    const auto writerIdleTimeout = chrono::milliseconds(100);
+    const auto writerRetryInterval = chrono::milliseconds(100);     // between attempts at a failed batch
+
+    size_t roundUpToPowerOfTwo(size_t n)
+    {
+        size_t p = 2;
+        while (p < n) p <<= 1;
+        return p;
+    }
+}
+
+JournalQueue::JournalQueue(TransactionJournal& target, size_t capacity, bool syncBatches)
+    : journal(target), syncEachBatch(syncBatches), mask(roundUpToPowerOfTwo(capacity) - 1),
+      slots(new Slot[mask + 1]), tail(0), head(0), durable(0), durableEnd(target.size()), stalls(0),
+      writerSleeping(false), stopping(false), batches(0), writerSleeps(0), peakOccupancy(0)
+{
+    // Slot i is free for the producer that claims position i
+    for (size_t i = 0; i <= mask; i++) slots[i].sequence.store(i, memory_order_relaxed);
+    writer = thread(&JournalQueue::run, this);
+}
+
+JournalQueue::~JournalQueue()
+{
+    {
+        lock_guard<mutex> lock(stateMutex);
+        stopping.store(true);
+        writerWake.notify_one();
+    }
+    writer.join();
+}
+
+JournalQueue& JournalQueue::shared(const string& journalPath)
+{
+    // Open the journal before the registry exists, so the registry (and with it every
+    // queue's final drain) is torn down before the journals it writes to
+    TransactionJournal& journal = TransactionJournal::shared(journalPath);
+
+    static mutex registryMutex;
+    static map<string, unique_ptr<JournalQueue>> registry;
+
+    lock_guard<mutex> lock(registryMutex);
+    auto& slot = registry[journalPath];
+    if (!slot) slot.reset(new JournalQueue(journal));
+    return *slot;
+}
+
+uint64_t JournalQueue::enqueue(JournalRecord record)
+{
+    // Reject what the writer could not encode here, where the caller can still see it
+    for (const string* field : {&record.fromAccount, &record.toAccount, &record.status, &record.transactionType}) {
+        if (field->size() > 0xFFFF) {
+            throw TransactionException("Journal field too long: " + field->substr(0, 32));
+        }
+    }
+
+    uint64_t pos = tail.load(memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &slots[pos & mask];
+        uint64_t seq = slot->sequence.load(memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(seq - pos);
+        if (diff == 0) {
+            if (tail.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            // Ring full: the writer has not released this slot yet
+            stalls.fetch_add(1, memory_order_relaxed);
+            this_thread::yield();
+            pos = tail.load(memory_order_relaxed);
+        } else {
+            pos = tail.load(memory_order_relaxed);
+        }
+    }
+
+    slot->record = move(record);
+    slot->sequence.store(pos + 1);
+
+    // Only wake the writer when it has gone to sleep; seq_cst on both sides means either
+    // it sees this slot before sleeping or this thread sees it asleep
+    if (writerSleeping.load()) {
+        lock_guard<mutex> lock(stateMutex);
+        writerWake.notify_one();
+    }
+    return pos + 1;
+}
+
+size_t JournalQueue::drain(string& buffer)
+{
+    buffer.clear();
+    uint64_t h = head.load(memory_order_relaxed);
+    size_t occupancy = static_cast<size_t>(tail.load(memory_order_relaxed) - h);
+    size_t count = 0;
+    while (count < maxBatchRecords) {
+        Slot& slot = slots[h & mask];
+        if (slot.sequence.load() != h + 1) break;
+        TransactionJournal::encode(slot.record, buffer);
+        slot.sequence.store(h + mask + 1, memory_order_release);    // free for the next lap
+        h++;
+        count++;
+    }
+    head.store(h, memory_order_release);
+
+    if (count > 0) {
+        lock_guard<mutex> lock(stateMutex);
+        batches++;
+        peakOccupancy = max(peakOccupancy, occupancy);
+    }
+    return count;
+}
+
+void JournalQueue::publishDurable(uint64_t sequence, uint64_t journalEnd)
+{
+    lock_guard<mutex> lock(stateMutex);
+    durableEnd.store(journalEnd, memory_order_release);
+    durable.store(sequence, memory_order_release);
+    failure.clear();
+    auto end = promises.upper_bound(sequence);
+    for (auto it = promises.begin(); it != end; ++it) it->second.set_value();
+    promises.erase(promises.begin(), end);
+    durableWake.notify_all();
+}
+
+void JournalQueue::reportFailure(const string& error)
+{
+    // Every waiter left is waiting for the failed batch or a later one
+    lock_guard<mutex> lock(stateMutex);
+    failure = error;
+    for (auto& waiting : promises) waiting.second.set_exception(make_exception_ptr(FileException(failure)));
+    promises.clear();
+    durableWake.notify_all();
+}
+
+void JournalQueue::run()
+{
+    string buffer;              // the batch being written, kept until it is durable
+    uint64_t batchEnd = 0;      // sequence of its last record
+    uint64_t batchOffset = 0;   // journal offset it was appended at
+    bool appended = false;      // it is in the journal and only the sync is left
+    while (true) {
+        if (buffer.empty() && drain(buffer) > 0) {
+            batchEnd = head.load(memory_order_relaxed);
+            appended = false;
+        }
+        if (!buffer.empty()) {
+            try {
+                if (!appended) {
+                    batchOffset = journal.appendEncoded(buffer);
+                    appended = true;
+                }
+                if (syncEachBatch) journal.sync();
+            } catch (const exception& e) {
+                // The batch is tried again until it goes through; nothing queued after it
+                // is written first, so durability never runs ahead of it
+                reportFailure(e.what());
+                unique_lock<mutex> lock(stateMutex);
+                if (stopping.load()) break;
+                writerWake.wait_for(lock, writerRetryInterval);
+                continue;
+            }
+            publishDurable(batchEnd, batchOffset + buffer.size());
+            buffer.clear();
+            continue;
+        }
+
+        unique_lock<mutex> lock(stateMutex);
+        writerSleeping.store(true);
+        uint64_t h = head.load(memory_order_relaxed);
+        bool ready = slots[h & mask].sequence.load() == h + 1;
+        if (!ready) {
+            if (stopping.load() && tail.load() == h) break;
+            writerSleeps++;
+            writerWake.wait_for(lock, writerIdleTimeout);
+        }
+        writerSleeping.store(false);
+    }
+}
+
+void JournalQueue::waitDurable(uint64_t sequence)
+{
+    unique_lock<mutex> lock(stateMutex);
+    durableWake.wait(lock, [this, sequence] {
+        return durable.load(memory_order_acquire) >= sequence || !failure.empty();
+    });
+    if (durable.load(memory_order_acquire) < sequence) throw FileException(failure);
+}
+
+future<void> JournalQueue::whenDurable(uint64_t sequence)
+{
+    promise<void> ready;
+    future<void> result = ready.get_future();
+    lock_guard<mutex> lock(stateMutex);
+    if (durable.load(memory_order_acquire) >= sequence) {
+        ready.set_value();
+    } else if (!failure.empty()) {
+        ready.set_exception(make_exception_ptr(FileException(failure)));
+    } else {
+        promises.emplace(sequence, move(ready));
+    }
+    return result;
+}
+
+uint64_t JournalQueue::flush()
+{
+    uint64_t last = tail.load();
+    waitDurable(last);
+    return last;
+}
+
+JournalQueueStats JournalQueue::stats() const
+{
+    JournalQueueStats s;
+    uint64_t t = tail.load();
+    uint64_t h = head.load();
+    s.capacity = mask + 1;
+    s.occupancy = static_cast<size_t>(t - h);
+    s.enqueued = t;
+    s.written = durable.load();
+    s.producerStalls = stalls.load(memory_order_relaxed);
+    lock_guard<mutex> lock(stateMutex);
+    s.peakOccupancy = peakOccupancy;
+    s.batches = batches;
+    s.writerSleeps = writerSleeps;
+    return s;
+}
@@ -0,0 +1,116 @@
+#ifndef JOURNAL_QUEUE_H
+#define JOURNAL_QUEUE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "journal.h"
+
+// ----------------------------Asynchronous journal queue--------------------------------
+//
+// Request threads hand journal records to a bounded multi-producer single-consumer ring
+// and return at once; one writer thread drains the ring in batches, encodes each batch
+// into a single buffer, appends it with one write call and (by default) one fdatasync.
+//
+// Enqueue is lock-free: a producer claims a slot with a CAS on the tail counter, moves
+// the record in and publishes the slot through its sequence number (the bounded queue
+// of D. Vyukov). A producer only blocks when the ring is full, and that is counted as a
+// stall. Every record gets a sequence number (1, 2, 3, ... in journal order); records
+// are durable in that order, so waitDurable(n) covers everything enqueued up to n.
+// A batch that fails to write is kept and tried again until it goes through; while it
+// fails, waiting for it (or anything after it) throws, and the ring fills up behind it.
+
+namespace Banking
+{
+    struct JournalQueueStats
+    {
+        size_t capacity = 0;
+        size_t occupancy = 0;           // records enqueued but not yet written
+        size_t peakOccupancy = 0;
+        uint64_t enqueued = 0;
+        uint64_t written = 0;
+        uint64_t batches = 0;
+        uint64_t producerStalls = 0;    // enqueues that found the ring full and had to wait
+        uint64_t writerSleeps = 0;      // times the writer found the ring empty and slept
+    };
+
+    class JournalQueue
+    {
+    private:
+        struct alignas(64) Slot
+        {
+            std::atomic<uint64_t> sequence;
+            JournalRecord record;
+        };
+
+        TransactionJournal& journal;
+        const bool syncEachBatch;
+        const size_t mask;
+        std::unique_ptr<Slot[]> slots;
+
+        alignas(64) std::atomic<uint64_t> tail;         // next position a producer claims
+        alignas(64) std::atomic<uint64_t> head;         // next position the writer reads
+        std::atomic<uint64_t> durable;                  // highest sequence written (and synced)
+        std::atomic<uint64_t> durableEnd;               // journal offset just past it
+        std::atomic<uint64_t> stalls;
+        std::atomic<bool> writerSleeping;
+        std::atomic<bool> stopping;
+
+        // Writer-side counters, read by stats() under stateMutex
+        uint64_t batches;
+        uint64_t writerSleeps;
+        size_t peakOccupancy;
+        std::string failure;                            // error of the batch being retried, empty once one succeeds
+
+        mutable std::mutex stateMutex;
+        std::condition_variable writerWake;
+        std::condition_variable durableWake;
+        std::multimap<uint64_t, std::promise<void>> promises;
+
+        std::thread writer;
+
+        void run();
+        size_t drain(std::string& buffer);
+        void publishDurable(uint64_t sequence, uint64_t journalEnd);
+        void reportFailure(const std::string& error);
+
+    public:
+        // capacity is rounded up to a power of two
+        explicit JournalQueue(TransactionJournal& target, size_t capacity = 1 << 16, bool syncEachBatch = true);
+        // Writes everything still queued, then stops the writer
+        ~JournalQueue();
+
+        JournalQueue(const JournalQueue&) = delete;
+        JournalQueue& operator=(const JournalQueue&) = delete;
+
+        // Process-wide queue in front of TransactionJournal::shared(journalPath)
+        static JournalQueue& shared(const std::string& journalPath);
+
+        // Queue one record, returns its sequence number (lock-free unless the ring is full)
+        uint64_t enqueue(JournalRecord record);
+
+        // Block until the record with this sequence number (and all before it) is durable.
+        // Throws FileException when the batch it waits for, or one before it, failed to
+        // write; the records stay queued and are retried.
+        void waitDurable(uint64_t sequence);
+        // Same, as a future that becomes ready once the record is durable
+        std::future<void> whenDurable(uint64_t sequence);
+        // Wait for everything enqueued so far, returns the last sequence number
+        uint64_t flush();
+
+        uint64_t durableSequence() const { return durable.load(std::memory_order_acquire); }
+        // Journal offset just past the last durable record: every record before it is
+        // whole and durable, so a reader can stop there without waiting for the queue
+        uint64_t durableOffset() const { return durableEnd.load(std::memory_order_acquire); }
+        JournalQueueStats stats() const;
+    };
+}
+
+#endif // JOURNAL_QUEUE_H
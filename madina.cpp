@@ -3,11 +3,47 @@
 #include <limits>
 using namespace Banking;
 
-// Function to generate random account numbers
-string generateAccountNumber()
+// Function to generate the next free account number
+string generateAccountNumber(Bank<Money>* bank)
 {
     static int counter = 24001;  // Starting account number
-    return "MDBSCE" + to_string(counter++);
+    string accNum;
+    do {
+        accNum = "MDBSCE" + to_string(counter++);
+    } while (bank->findAccount(accNum));   // numbers from earlier runs are taken
+    return accNum;
+}
+
+// Start (or, with endOfDay, last second) of a local YYYY-MM-DD date
+time_t parseLocalDate(const string& text, bool endOfDay)
+{
+    struct tm tm = {};
+    const char* end = strptime(text.c_str(), "%Y-%m-%d", &tm);
+    if (!end || *end != '\0') {
+        throw Banking::Exceptions::TransactionException("Invalid date (use YYYY-MM-DD): " + text);
+    }
+    if (endOfDay) {
+        tm.tm_hour = 23;
+        tm.tm_min = 59;
+        tm.tm_sec = 59;
+    }
+    tm.tm_isdst = -1;
+    return mktime(&tm);
+}
+
+// Page through the transactions matching filter, newest first
+void browseTransactions(const TransactionFilter& filter)
+{
+    const size_t pageSize = 20;
+    uint64_t cursor = firstPage;
+    while (true) {
+        TransactionPage page = Transaction::loadTransactions(filter, cursor, pageSize);
+        if (!page.more) break;
+        string answer;
+        cout << "Press Enter for the next page, q to stop: ";
+        if (!getline(cin, answer) || answer == "q" || answer == "Q") break;
+        cursor = page.next;
+    }
 }
 
 // Function to get customer information
@@ -28,7 +64,7 @@ PersonalInfo getCustomerInfo()
 
 // Function to display menu
 
-void adminMenu(Bank<double>* bank)
+void adminMenu(Bank<Money>* bank)
 {
     int choice;
     do {
@@ -41,7 +77,13 @@ void adminMenu(Bank<double>* bank)
         cout << "6. View All Loans\n";
         cout << "7. View All Transactions\n";
         cout << "8. Register New Admin\n";
-        cout << "9. Logout\n";
+        cout << "9. Run Zakat Cycle\n";
+        cout << "10. Run Payroll\n";
+        cout << "11. Accrue Daily Interest\n";
+        cout << "12. Generate Statements\n";
+        cout << "13. Reconcile Balances\n";
+        cout << "14. Balance As Of Date\n";
+        cout << "15. Logout\n";
         cout << "Enter choice: ";
         cin >> choice;
         cin.ignore();
@@ -50,7 +92,7 @@ void adminMenu(Bank<double>* bank)
             case 1: { // Create Account
                 try {
                     string type;
-                    double balance;
+                    Money balance;
                     cout << "Enter account type (Saving/Business): ";
                     getline(cin, type);
                     cout << "Enter initial balance: ";
@@ -58,7 +100,7 @@ void adminMenu(Bank<double>* bank)
                     cin.ignore();
                     
                     PersonalInfo info = getCustomerInfo();
-                    string accNum = generateAccountNumber();
+                    string accNum = generateAccountNumber(bank);
                     
                     if (bank->createAccount(accNum, balance, type, info)) {
                         cout << "Account created! Number: " << accNum << endl;
@@ -125,14 +167,13 @@ void adminMenu(Bank<double>* bank)
          }
             case 4:
             {
-                 // View all accounts using map
+                 // View all accounts straight from the account store
                  cout << "\nAll Accounts:\n";
-                 // Changed from getAccountMap() to accessing accounts directly
-                 for (auto* acc : bank->getAccounts()) {
-                     cout << "Account #: " << acc->getAccountNumber() << "\n";
-                     acc->displayAccountInfo();
+                 bank->forEachAccount([](auto& acc) {
+                     cout << "Account #: " << acc.getAccountNumber() << "\n";
+                     acc.displayAccountInfo();
                      cout << "------------------------\n";
-                 }
+                 });
                  break;
             }
             case 5:
@@ -150,9 +191,35 @@ void adminMenu(Bank<double>* bank)
                 break;
             }
             case 7:
-            { // View all transactions
-                cout << "\nAll Transactions:\n";
-                Transaction::loadTransactions();
+            { // Page through the transactions, optionally filtered
+                try {
+                    TransactionFilter filter;
+                    string text;
+                    cout << "Account (blank for any): ";
+                    getline(cin, filter.account);
+                    cout << "Type (blank for any): ";
+                    getline(cin, filter.transactionType);
+                    cout << "Status (blank for any): ";
+                    getline(cin, filter.status);
+                    cout << "From date YYYY-MM-DD (blank for any): ";
+                    getline(cin, text);
+                    if (!text.empty()) filter.from = parseLocalDate(text, false);
+                    cout << "To date YYYY-MM-DD (blank for any): ";
+                    getline(cin, text);
+                    if (!text.empty()) filter.to = parseLocalDate(text, true);
+                    cout << "Minimum amount (blank for any): ";
+                    getline(cin, text);
+                    if (!text.empty()) filter.minAmount = Money::parse(text);
+                    cout << "Maximum amount (blank for any): ";
+                    getline(cin, text);
+                    if (!text.empty()) filter.maxAmount = Money::parse(text);
+
+                    cout << "\nTransactions (newest first):\n";
+                    browseTransactions(filter);
+                }
+                catch (const exception& e) {
+                    cout << "Transaction Error: " << e.what() << "\n";
+                }
                 break;
             }
             case 8:
@@ -183,6 +250,154 @@ void adminMenu(Bank<double>* bank)
                  break;
                 }
             case 9:
+            { // Annual zakat for every saving account
+                try {
+                    char answer;
+                    cout << "Dry run only (y/n): ";
+                    cin >> answer;
+                    cin.ignore();
+                    bool dryRun = answer == 'y' || answer == 'Y';
+
+                    ZakatReport<Money> report = bank->runZakatCycle(dryRun);
+                    for (const auto& line : report.lines) {
+                        cout << line.accountNumber << " | Balance: $" << line.balanceBefore
+                             << " | Zakat: $" << line.zakat << "\n";
+                    }
+                    cout << (report.dryRun ? "Zakat due (dry run, nothing deducted)\n" : "Zakat deducted\n")
+                         << "Saving accounts: " << report.savingAccounts
+                         << " | Charged: " << report.lines.size()
+                         << " | Below nisab: " << report.belowNisab
+                         << " | Skipped: " << report.skipped << "\n"
+                         << "Total zakat: $" << report.totalZakat << "\n";
+                }
+                catch (const exception& e) {
+                    cout << "Zakat Error: " << e.what() << "\n";
+                }
+                break;
+            }
+            case 10:
+            { // Pay every employee (optionally one designation) in one run
+                try {
+                    string designation;
+                    cout << "Designation to pay (blank for all): ";
+                    getline(cin, designation);
+
+                    PayrollReport<Money> report = bank->runPayroll([&designation](const BankMember& emp) {
+                        return designation.empty() || emp.getDesignation() == designation;
+                    });
+                    for (const auto& credit : report.credits) {
+                        cout << credit.accountNumber << " | Employees: " << credit.employees
+                             << " | Credited: $" << credit.amount << "\n";
+                    }
+                    for (const auto& failure : report.failures) {
+                        cout << "Not paid: " << failure << "\n";
+                    }
+                    cout << "Paid " << report.paid << " of " << report.employees << " employees"
+                         << " into " << report.credits.size() << " accounts"
+                         << " | Duplicates skipped: " << report.duplicates << "\n"
+                         << "Total paid: $" << report.totalPaid << "\n";
+                }
+                catch (const exception& e) {
+                    cout << "Payroll Error: " << e.what() << "\n";
+                }
+                break;
+            }
+            case 11:
+            { // Today's interest for every saving account (standard tiers)
+                try {
+                    char answer;
+                    cout << "Dry run only (y/n): ";
+                    cin >> answer;
+                    cin.ignore();
+                    bool dryRun = answer == 'y' || answer == 'Y';
+
+                    InterestReport<Money> report =
+                        bank->runInterestAccrual(InterestSchedule<Money>::standard(), 0, dryRun);
+                    cout << (report.dryRun ? "Interest due (dry run, nothing credited)" : "Interest credited")
+                         << " for " << formatAccrualDay(report.day) << "\n"
+                         << "Saving accounts: " << report.savingAccounts
+                         << " | Credited: " << report.credited
+                         << " | Already accrued: " << report.alreadyAccrued
+                         << " | Recovered: " << report.recovered
+                         << " | No interest: " << report.noInterest << "\n"
+                         << "Total interest: $" << report.totalInterest << "\n";
+                }
+                catch (const exception& e) {
+                    cout << "Interest Error: " << e.what() << "\n";
+                }
+                break;
+            }
+            case 12:
+            { // Statement files for a period, one per account
+                try {
+                    string fromText, toText, accNum, outputDir;
+                    cout << "From date (YYYY-MM-DD): ";
+                    getline(cin, fromText);
+                    cout << "To date (YYYY-MM-DD): ";
+                    getline(cin, toText);
+                    cout << "Account number (blank for all): ";
+                    getline(cin, accNum);
+                    cout << "Output directory (blank for statements): ";
+                    getline(cin, outputDir);
+                    if (outputDir.empty()) outputDir = "statements";
+
+                    vector<string> accounts;
+                    if (!accNum.empty()) accounts.push_back(accNum);
+                    StatementSummary summary = bank->generateStatements(
+                        parseLocalDate(fromText, false), parseLocalDate(toText, true), outputDir, accounts);
+                    cout << "Statements written: " << summary.statements
+                         << " | Entries: " << summary.entries
+                         << " | Journal records read: " << summary.journalRecords
+                         << " | Days skipped: " << summary.segmentsSkipped << "\n"
+                         << "Directory: " << outputDir << " | Elapsed: " << summary.elapsedMs << " ms\n";
+                }
+                catch (const exception& e) {
+                    cout << "Statement Error: " << e.what() << "\n";
+                }
+                break;
+            }
+            case 13:
+            { // Replay the journal and report accounts whose balance disagrees with it
+                try {
+                    string reportPath;
+                    cout << "Report file (blank for reconciliation.csv): ";
+                    getline(cin, reportPath);
+                    if (reportPath.empty()) reportPath = "reconciliation.csv";
+
+                    ReconcileSummary summary = bank->reconcileBalances(reportPath);
+                    cout << "Accounts: " << summary.accounts
+                         << " | Matched: " << summary.matched
+                         << " | Mismatched: " << summary.mismatched
+                         << " | Not in book: " << summary.notInBook << "\n"
+                         << "Journal records: " << summary.journalRecords
+                         << " | Corrupt: " << summary.corruptRecords << "\n"
+                         << "Book total: $" << summary.bookTotal
+                         << " | Journal total: $" << summary.journalTotal << "\n"
+                         << "Report: " << reportPath << " | Elapsed: " << summary.elapsedMs << " ms\n";
+                }
+                catch (const exception& e) {
+                    cout << "Reconciliation Error: " << e.what() << "\n";
+                }
+                break;
+            }
+            case 14:
+            { // What an account held at the end of a past day
+                try {
+                    string accNum, dateText;
+                    cout << "Account number: ";
+                    getline(cin, accNum);
+                    cout << "Date (YYYY-MM-DD): ";
+                    getline(cin, dateText);
+
+                    Money balance = bank->balanceAsOf(accNum, parseLocalDate(dateText, true));
+                    cout << "Balance of " << accNum << " at the end of " << dateText << ": $" << balance << "\n";
+                }
+                catch (const exception& e) {
+                    cout << "Balance Error: " << e.what() << "\n";
+                }
+                break;
+            }
+            case 15:
                 return;
             default:
                 cout << "Invalid choice!\n";
@@ -190,7 +405,7 @@ void adminMenu(Bank<double>* bank)
     } while (true);
 }
 
-void customerMenu(Bank<double>* bank, const string& accountNumber) {
+void customerMenu(Bank<Money>* bank, const string& accountNumber) {
     int choice;
     do {
         cout << "\nCustomer Menu\n";
@@ -212,7 +427,7 @@ void customerMenu(Bank<double>* bank, const string& accountNumber) {
             case 1:{ // Deposit
                 try {
                     string accNum;
-                    double amount;
+                    Money amount;
                     cout << "Enter account number: ";
                     getline(cin, accNum);
                     cout << "Enter amount to deposit: ";
@@ -223,15 +438,8 @@ void customerMenu(Bank<double>* bank, const string& accountNumber) {
                         throw Banking::Exceptions::TransactionException("Amount must be positive");
                     }
                     
-                    auto account = bank->findAccount(accNum);
-                    if (account) {
-                        account->updateBalance(amount);
-                        Transaction("Bank", accNum, amount, "Completed", "Deposit")
-                            .saveTransaction();
-                        cout << "Deposit successful!\n";
-                    } else {
-                        throw Banking::Exceptions::AccountException("Account not found");
-                    }
+                    bank->deposit(accNum, amount);
+                    cout << "Deposit successful!\n";
                 }
                 catch (const Banking::Exceptions::TransactionException& e) {
                     cout << "Transaction Error: " << e.what() << "\n";
@@ -248,7 +456,7 @@ void customerMenu(Bank<double>* bank, const string& accountNumber) {
             case 2:{ // Withdraw
                 try {
                     string accNum;
-                    double amount;
+                    Money amount;
                     cout << "Enter account number: ";
                     getline(cin, accNum);
                     cout << "Enter amount to withdraw: ";
@@ -259,15 +467,8 @@ void customerMenu(Bank<double>* bank, const string& accountNumber) {
                         throw Banking::Exceptions::TransactionException("Amount must be positive");
                     }
                     
-                    auto account = bank->findAccount(accNum);
-                    if (account) {
-                        if (account->withdraw(amount)) {
-                            Transaction(accNum, "Bank", amount, "Completed", "Withdrawal")
-                                .saveTransaction();
-                            cout << "Withdrawal successful!\n";
-                        }
-                    } else {
-                        throw Banking::Exceptions::AccountException("Account not found");
+                    if (bank->withdraw(accNum, amount) > 0) {
+                        cout << "Withdrawal successful!\n";
                     }
                 }
                 catch (const Banking::Exceptions::TransactionException& e) {
@@ -285,7 +486,7 @@ void customerMenu(Bank<double>* bank, const string& accountNumber) {
             case 3:{ // Transfer
                 try {
                     string fromAcc, toAcc;
-                    double amount;
+                    Money amount;
                     cout << "Enter your account number: ";
                     getline(cin, fromAcc);
                     cout << "Enter recipient account number: ";
@@ -298,17 +499,8 @@ void customerMenu(Bank<double>* bank, const string& accountNumber) {
                         throw Banking::Exceptions::TransactionException("Amount must be positive");
                     }
                     
-                    auto fromAccount = bank->findAccount(fromAcc);
-                    auto toAccount = bank->findAccount(toAcc);
-                    
-                    if (!fromAccount || !toAccount) {
-                        throw Banking::Exceptions::AccountException("One or both accounts not found");
-                    }
-                    
-                    if (fromAccount->withdraw(amount)) {
-                        toAccount->updateBalance(amount);
-                        Transaction(fromAcc, toAcc, amount, "Completed", "Transfer")
-                            .saveTransaction();
+                    // Both legs and the journal record are applied together by the bank
+                    if (bank->transfer(fromAcc, toAcc, amount)) {
                         cout << "Transfer successful!\n";
                     }
                 }
@@ -377,8 +569,11 @@ void customerMenu(Bank<double>* bank, const string& accountNumber) {
             }
             
             case 6:
-            {  // View Transactions
-                Transaction::loadTransactions();
+            {  // Page through the transactions of the customer's own account
+                TransactionFilter filter;
+                filter.account = accountNumber;
+                cout << "\nTransactions (newest first):\n";
+                browseTransactions(filter);
                 break;
             }
             case 7:
@@ -406,8 +601,77 @@ void customerMenu(Bank<double>* bank, const string& accountNumber) {
     } while (true);
 }
 
-int main() {
-    Bank<double>* bank = Bank<double>::getInstance();
+// Non-interactive bulk mode: ./r.out --apply-batch file.jsonl|file.csv [--report out.csv]
+int applyBatchCommand(Bank<Money>* bank, int argc, char* argv[])
+{
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " --apply-batch <file.jsonl|file.csv> [--report <report.csv>]\n";
+        return 2;
+    }
+    string input = argv[2];
+    string reportPath = input + ".report.csv";
+    if (argc >= 5 && string(argv[3]) == "--report") reportPath = argv[4];
+
+    try {
+        BatchSummary summary = bank->applyBatchFile(input, reportPath);
+        cout << "Records: " << summary.records
+             << " | Applied: " << summary.applied
+             << " | Failed: " << summary.failed << "\n"
+             << "Elapsed: " << summary.elapsedMs << " ms"
+             << " | " << static_cast<long long>(summary.perSecond()) << " transactions/s\n"
+             << "Report: " << reportPath << "\n";
+        return summary.failed == 0 ? 0 : 1;
+    }
+    catch (const exception& e) {
+        cerr << "Batch Error: " << e.what() << "\n";
+        return 2;
+    }
+}
+
+// Non-interactive settlement: ./r.out --settle transfers.jsonl|transfers.csv
+// Nets the transfers per account and applies them all or not at all
+int settleCommand(Bank<Money>* bank, int argc, char* argv[])
+{
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " --settle <file.jsonl|file.csv>\n";
+        return 2;
+    }
+    try {
+        SettlementReport<Money> report = bank->settleNettedFile(argv[2]);
+        for (const auto& violation : report.violations) {
+            cerr << "Refused: " << violation << "\n";
+        }
+        cout << (report.settled ? "Settled" : "Not settled") << " | Transfers: " << report.transfers
+             << " | Accounts: " << report.positions.size()
+             << " | Balance changes: " << report.mutations << "\n"
+             << "Gross: $" << report.grossVolume << " | Net: $" << report.netVolume
+             << " | Elapsed: " << report.elapsedMs << " ms\n";
+        return report.settled ? 0 : 1;
+    }
+    catch (const exception& e) {
+        cerr << "Settlement Error: " << e.what() << "\n";
+        return 2;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Bank<Money>* bank = Bank<Money>::getInstance();
+
+    // Move any history left in transactions.json into the journal (first run only)
+    try {
+        size_t imported = Transaction::importTransactions();
+        if (imported > 0) {
+            cout << "Imported " << imported << " transactions into the journal\n";
+        }
+    } catch (const Banking::Exceptions::FileException& e) {
+        cerr << "Journal import error: " << e.what() << endl;
+    }
+    if (argc > 1 && string(argv[1]) == "--apply-batch") {
+        return applyBatchCommand(bank, argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--settle") {
+        return settleCommand(bank, argc, argv);
+    }
     bank->loadUsersFromFile();
     
     // Add default admin if none exists
@@ -441,6 +705,7 @@ int main() {
                 } else {
                     customerMenu(bank, user->getAssociatedAccount());
                 }
+                bank->flush();   // make the session's changes durable on logout
             } else {
                 cout << "Invalid credentials!\n";
             }
@@ -455,14 +720,16 @@ int main() {
             getline(cin, password);
 
             // Create account
-            string accNum = generateAccountNumber();
-            bank->createAccount(accNum, 0.0, "Saving", info);
+            string accNum = generateAccountNumber(bank);
+            bank->createAccount(accNum, Money(), "Saving", info);
+            bank->flush();
             
             // Create user
             bank->addUser(User(username, password, "customer", accNum));
             cout << "Registration successful! Your account number is: " << accNum << "\n";
         }
         else if (mainChoice == 3) {
+            bank->flush();
             break;
         }
         else {
@@ -0,0 +1,213 @@
+// ----------------------------Fixed-point money implementation--------------------------------
+
+#include "money.h"
+#include <cmath>
+#include <cstdio>
+#include <istream>
+#include <ostream>
+
+using namespace std;
+using namespace Banking;
+
+namespace
+{
+    const uint64_t int64Magnitude = static_cast<uint64_t>(INT64_MAX) + 1;    // of INT64_MIN
+
+    // Magnitude of a quotient whose dropped remainder was nonzero (inexact) and below,
+    // exactly at or above half a unit (half < 0, 0, > 0), rounded with the given policy
+    // and signed; throws when the result leaves int64
+    int64_t roundedQuotient(uint64_t q, bool inexact, int half, bool negative, Rounding rounding)
+    {
+        bool away = false;
+        if (inexact) {
+            switch (rounding) {
+                case Rounding::TowardZero:       away = false; break;
+                case Rounding::AwayFromZero:     away = true; break;
+                case Rounding::Floor:            away = negative; break;
+                case Rounding::Ceiling:          away = !negative; break;
+                case Rounding::HalfAwayFromZero: away = half >= 0; break;
+                case Rounding::HalfEven:         away = half > 0 || (half == 0 && q % 2 != 0); break;
+            }
+        }
+        if (away) {
+            if (q == UINT64_MAX) throw overflow_error("Money overflow");
+            q++;
+        }
+        if (q > (negative ? int64Magnitude : static_cast<uint64_t>(INT64_MAX))) throw overflow_error("Money overflow");
+        return negative ? static_cast<int64_t>(0 - q) : static_cast<int64_t>(q);
+    }
+
+    uint64_t magnitudeOf(int64_t value)
+    {
+        return value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    }
+
+    // a * b as a 128-bit value split into 64-bit halves, from four 32 x 32 products
+    void multiplyWide(uint64_t a, uint64_t b, uint64_t& high, uint64_t& low)
+    {
+        const uint64_t mask = 0xFFFFFFFFu;
+        uint64_t lowLow = (a & mask) * (b & mask);
+        uint64_t lowHigh = (a & mask) * (b >> 32);
+        uint64_t highLow = (a >> 32) * (b & mask);
+        uint64_t highHigh = (a >> 32) * (b >> 32);
+        uint64_t middle = (lowLow >> 32) + (lowHigh & mask) + (highLow & mask);
+        high = highHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32);
+        low = (middle << 32) | (lowLow & mask);
+    }
+
+    // (high:low) / divisor by shift-and-subtract. False when the quotient needs more
+    // than 64 bits.
+    bool divideWide(uint64_t high, uint64_t low, uint64_t divisor, uint64_t& quotient, uint64_t& remainder)
+    {
+        if (high >= divisor) return false;
+        uint64_t rem = high;
+        uint64_t q = 0;
+        for (int bit = 63; bit >= 0; bit--) {
+            bool carry = (rem >> 63) != 0;      // rem * 2 takes a 65th bit
+            rem = (rem << 1) | ((low >> bit) & 1);
+            q <<= 1;
+            if (carry || rem >= divisor) {
+                rem -= divisor;
+                q |= 1;
+            }
+        }
+        quotient = q;
+        remainder = rem;
+        return true;
+    }
+}
+
+Money Money::fromDouble(double value, Rounding rounding)
+{
+    if (!isfinite(value)) throw invalid_argument("Money from a non-finite value");
+    // 15 significant digits give back the decimal the double was written from
+    // (0.285 is 0.28499999999999998 in binary but converts to 0.29 when rounding half up)
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.15g", value);
+    return parse(buffer, rounding);
+}
+
+Money Money::parse(const string& text, Rounding rounding)
+{
+    size_t i = 0;
+    bool negative = false;
+    if (i < text.size() && (text[i] == '+' || text[i] == '-')) negative = text[i++] == '-';
+
+    string digits;               // significant digits; value = digits * 10^exponent
+    int exponent = 0;
+    bool seenDigit = false;
+    bool seenPoint = false;
+    for (; i < text.size(); i++) {
+        char c = text[i];
+        if (c >= '0' && c <= '9') {
+            seenDigit = true;
+            if (!digits.empty() || c != '0') digits += c;
+            if (seenPoint) exponent--;
+        } else if (c == '.' && !seenPoint) {
+            seenPoint = true;
+        } else {
+            break;
+        }
+    }
+    if (!seenDigit) throw invalid_argument("Invalid amount: " + text);
+
+    if (i < text.size() && (text[i] == 'e' || text[i] == 'E')) {
+        size_t pos = 0;
+        int explicitExponent;
+        try {
+            explicitExponent = stoi(text.substr(i + 1), &pos);
+        } catch (const exception&) {
+            throw invalid_argument("Invalid amount: " + text);
+        }
+        if (explicitExponent > 1000 || explicitExponent < -1000) throw invalid_argument("Invalid amount: " + text);
+        exponent += explicitExponent;
+        i += 1 + pos;
+    }
+    if (i != text.size()) throw invalid_argument("Invalid amount: " + text);
+    if (digits.empty()) return Money();
+    while (digits.back() == '0') {
+        digits.pop_back();
+        exponent++;
+    }
+
+    // minor = digits * 10^shift: the digits before the cut are the whole minor units,
+    // the ones after it the fraction that is rounded away
+    long shift = static_cast<long>(exponent) + fractionDigits;
+    long whole = static_cast<long>(digits.size()) + shift;
+    uint64_t q = 0;
+    for (long k = 0; k < whole; k++) {
+        uint64_t digit = k < static_cast<long>(digits.size()) ? static_cast<uint64_t>(digits[k] - '0') : 0;
+        if (q > (UINT64_MAX - digit) / 10) throw overflow_error("Money overflow");
+        q = q * 10 + digit;
+    }
+    bool inexact = false;
+    int half = -1;
+    if (whole < static_cast<long>(digits.size())) {
+        // The fraction starts with -whole zeros when the digits begin below a minor unit
+        size_t first = whole < 0 ? 0 : static_cast<size_t>(whole);
+        inexact = true;                             // digits has no trailing zeros
+        if (whole >= 0) {
+            char lead = digits[first];
+            bool restNonZero = digits.find_first_not_of('0', first + 1) != string::npos;
+            half = lead > '5' || (lead == '5' && restNonZero) ? 1 : lead == '5' ? 0 : -1;
+        }
+    }
+    return fromMinor(roundedQuotient(q, inexact, half, negative, rounding));
+}
+
+string Money::toString() const
+{
+    uint64_t magnitude = minor < 0 ? 0 - static_cast<uint64_t>(minor) : static_cast<uint64_t>(minor);
+    string fraction = to_string(magnitude % minorPerUnit);
+    if (fraction.size() < static_cast<size_t>(fractionDigits)) fraction.insert(0, fractionDigits - fraction.size(), '0');
+    return (minor < 0 ? "-" : "") + to_string(magnitude / minorPerUnit) + "." + fraction;
+}
+
+Money Money::mulDivWide(int64_t num, int64_t den, Rounding rounding) const
+{
+    if (den == 0) throw invalid_argument("Money division by zero");
+    if (minor == 0 || num == 0) return Money();
+    bool negative = ((minor < 0) != (num < 0)) != (den < 0);
+    uint64_t high, low, q, rem;
+    uint64_t divisor = magnitudeOf(den);
+    multiplyWide(magnitudeOf(minor), magnitudeOf(num), high, low);
+    if (!divideWide(high, low, divisor, q, rem)) throw overflow_error("Money overflow");
+    int half = rem > divisor - rem ? 1 : rem == divisor - rem ? 0 : -1;
+    return fromMinor(roundedQuotient(q, rem != 0, half, negative, rounding));
+}
+
+ostream& Banking::operator<<(ostream& os, const Money& m)
+{
+    return os << m.toString();
+}
+
+istream& Banking::operator>>(istream& is, Money& m)
+{
+    string token;
+    if (is >> token) {
+        try {
+            m = Money::parse(token);
+        } catch (const exception&) {
+            is.setstate(ios::failbit);
+        }
+    }
+    return is;
+}
+
+void Banking::to_json(nlohmann::json& j, const Money& m)
+{
+    j = m.toString();
+}
+
+void Banking::from_json(const nlohmann::json& j, Money& m)
+{
+    if (j.is_number_integer()) {
+        m = Money(j.get<int64_t>());
+    } else if (j.is_number()) {
+        m = Money::fromDouble(j.get<double>());
+    } else if (j.is_string()) {
+        m = Money::parse(j.get<string>());
+    } else {
+        throw invalid_argument("Amount must be a number");
+    }
+}
@@ -0,0 +1,185 @@
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <nlohmann/json.hpp>
+
+// ----------------------------Fixed-point money--------------------------------
+//
+// Money holds an amount as a signed 64-bit count of minor units (1/100 of a unit), so
+// sums and differences are exact and balances never drift the way float and double
+// do. Arithmetic is checked: any result outside int64 throws std::overflow_error
+// instead of wrapping. Nothing is rounded implicitly; conversions from double and
+// multiplication by a rate take an explicit Rounding policy.
+
+namespace Banking
+{
+    enum class Rounding
+    {
+        TowardZero,
+        AwayFromZero,
+        Floor,
+        Ceiling,
+        HalfAwayFromZero,    // commercial rounding, 0.005 -> 0.01
+        HalfEven             // banker's rounding, ties go to the even minor unit
+    };
+
+    class Money
+    {
+    private:
+        int64_t minor;
+
+        static int64_t checkedAdd(int64_t a, int64_t b)
+        {
+            if (b > 0 ? a > INT64_MAX - b : a < INT64_MIN - b) throw std::overflow_error("Money overflow");
+            return a + b;
+        }
+
+        // True when a * b fits in int64
+        static bool productFits(int64_t a, int64_t b)
+        {
+            if (a == 0 || b == 0) return true;
+            if (a > 0) return b > 0 ? a <= INT64_MAX / b : b >= INT64_MIN / a;
+            return b > 0 ? a >= INT64_MIN / b : a >= INT64_MAX / b;
+        }
+
+        static int64_t checkedMul(int64_t a, int64_t b)
+        {
+            if (!productFits(a, b)) throw std::overflow_error("Money overflow");
+            return a * b;
+        }
+
+        // n / d (d > 0) rounded with the given policy
+        static int64_t roundedDiv(int64_t n, int64_t d, Rounding rounding)
+        {
+            int64_t q = n / d;
+            int64_t rem = n % d;
+            if (rem == 0) return q;
+            bool negative = n < 0;
+            int64_t twice = (rem < 0 ? -rem : rem) * 2;    // no overflow: |rem| < d
+            bool away = false;
+            switch (rounding) {
+                case Rounding::TowardZero:       away = false; break;
+                case Rounding::AwayFromZero:     away = true; break;
+                case Rounding::Floor:            away = negative; break;
+                case Rounding::Ceiling:          away = !negative; break;
+                case Rounding::HalfAwayFromZero: away = twice >= d; break;
+                case Rounding::HalfEven:         away = twice > d || (twice == d && q % 2 != 0); break;
+            }
+            return away ? q + (negative ? -1 : 1) : q;
+        }
+
+        Money mulDivWide(int64_t num, int64_t den, Rounding rounding) const;
+
+    public:
+        static const int64_t minorPerUnit = 100;
+        static const int fractionDigits = 2;
+
+        constexpr Money() : minor(0) {}
+
+        // Whole units, so Money m = 500 and comparisons such as balance >= 20000 work
+        template<typename I, typename std::enable_if<std::is_integral<I>::value, int>::type = 0>
+        Money(I units) : minor(checkedMul(static_cast<int64_t>(units), minorPerUnit)) {}
+
+        // Doubles only convert explicitly, rounding half away from zero
+        explicit Money(double value) : minor(fromDouble(value).minor) {}
+
+        static Money fromMinor(int64_t minorUnits)
+        {
+            Money m;
+            m.minor = minorUnits;
+            return m;
+        }
+
+        static Money fromDouble(double value, Rounding rounding = Rounding::HalfAwayFromZero);
+
+        // Exact decimal text such as "-1234.5" or "0.125"; digits past the second
+        // decimal place are rounded with the given policy. Throws std::invalid_argument.
+        static Money parse(const std::string& text, Rounding rounding = Rounding::HalfAwayFromZero);
+
+        int64_t minorUnits() const { return minor; }
+        double toDouble() const { return static_cast<double>(minor) / minorPerUnit; }
+        std::string toString() const;
+
+        // this * num / den, computed exactly and rounded once (e.g. 2.5% is 25 / 1000).
+        // Inline so constant rates compile to a multiply; falls back to 128-bit math.
+        Money mulDiv(int64_t num, int64_t den, Rounding rounding) const
+        {
+            if (den > 0 && den < (INT64_MAX >> 1) && productFits(minor, num)) {
+                return fromMinor(roundedDiv(minor * num, den, rounding));
+            }
+            return mulDivWide(num, den, rounding);
+        }
+
+        Money& operator+=(const Money& other) { minor = checkedAdd(minor, other.minor); return *this; }
+        Money& operator-=(const Money& other)
+        {
+            if (other.minor == INT64_MIN) throw std::overflow_error("Money overflow");
+            minor = checkedAdd(minor, -other.minor);
+            return *this;
+        }
+        Money& operator*=(int64_t factor) { minor = checkedMul(minor, factor); return *this; }
+
+        Money operator-() const { return Money() - *this; }
+
+        friend Money operator+(Money a, const Money& b) { return a += b; }
+        friend Money operator-(Money a, const Money& b) { return a -= b; }
+        friend Money operator*(Money a, int64_t factor) { return a *= factor; }
+        friend Money operator*(int64_t factor, Money a) { return a *= factor; }
+
+        friend bool operator==(const Money& a, const Money& b) { return a.minor == b.minor; }
+        friend bool operator!=(const Money& a, const Money& b) { return a.minor != b.minor; }
+        friend bool operator<(const Money& a, const Money& b) { return a.minor < b.minor; }
+        friend bool operator<=(const Money& a, const Money& b) { return a.minor <= b.minor; }
+        friend bool operator>(const Money& a, const Money& b) { return a.minor > b.minor; }
+        friend bool operator>=(const Money& a, const Money& b) { return a.minor >= b.minor; }
+    };
+
+    // Prints "1234.50"; reads decimal text exactly (failbit on malformed input)
+    std::ostream& operator<<(std::ostream& os, const Money& m);
+    std::istream& operator>>(std::istream& is, Money& m);
+
+    // Stored in JSON as exact decimal text ("1234.50"), never through a double; plain
+    // numbers written by older builds are still read
+    void to_json(nlohmann::json& j, const Money& m);
+    void from_json(const nlohmann::json& j, Money& m);
+
+    // Conversions and rate arithmetic used by the Bank templates, so the same code runs
+    // on floating-point balances and on Money
+    template<typename B>
+    struct AmountTraits
+    {
+        static B fromDouble(double value) { return static_cast<B>(value); }
+        // Decimal text as written by a user or a file; throws std::invalid_argument
+        static B parse(const std::string& text)
+        {
+            size_t used = 0;
+            double value = std::stod(text, &used);
+            if (used != text.size()) throw std::invalid_argument("Invalid amount: " + text);
+            return static_cast<B>(value);
+        }
+        static double toDouble(B amount) { return static_cast<double>(amount); }
+        static B mulDiv(B amount, int64_t num, int64_t den, Rounding)
+        {
+            return amount * (static_cast<B>(num) / static_cast<B>(den));
+        }
+    };
+
+    template<>
+    struct AmountTraits<Money>
+    {
+        static Money fromDouble(double value) { return Money::fromDouble(value); }
+        static Money parse(const std::string& text) { return Money::parse(text); }
+        static double toDouble(Money amount) { return amount.toDouble(); }
+        static Money mulDiv(Money amount, int64_t num, int64_t den, Rounding rounding)
+        {
+            return amount.mulDiv(num, den, rounding);
+        }
+    };
+}
+
+#endif // MONEY_H
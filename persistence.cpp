@@ -0,0 +1,166 @@
+// ----------------------------Account persistence implementation--------------------------------
+
+#include "bank.h"
+#include "persistence.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Banking;
+using namespace Banking::Exceptions;
+
+namespace
+{
+    void writeAll(int fd, const char* data, size_t length, const string& path)
+    {
+        while (length > 0) {
+            ssize_t n = ::write(fd, data, length);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw FileException("Write to " + path + " failed: " + strerror(errno));
+            }
+            data += n;
+            length -= static_cast<size_t>(n);
+        }
+    }
+
+    // Walk the log and report committed batches; returns the end of the last one
+    uint64_t scanCommitted(const string& logPath,
+                           const function<void(const vector<json>&)>& onBatch)
+    {
+        ifstream file(logPath);
+        if (!file.is_open()) return 0;
+
+        uint64_t offset = 0;
+        uint64_t committedEnd = 0;
+        vector<json> pending;
+        string line;
+        while (getline(file, line)) {
+            if (file.eof()) break;          // last line without newline is torn
+            offset += line.size() + 1;
+
+            json record = json::parse(line, nullptr, false);
+            if (record.is_discarded()) break;
+
+            if (record.contains("commit")) {
+                if (record["commit"].get<size_t>() != pending.size()) break;
+                onBatch(pending);
+                pending.clear();
+                committedEnd = offset;
+            } else {
+                pending.push_back(move(record));
+            }
+        }
+        return committedEnd;
+    }
+}
+
+DeltaLog::DeltaLog(const string& logPath, const function<void(const json&)>& apply)
+    : path(logPath), fd(-1), records(0), batches(0), committedEnd(0), tornTail(false)
+{
+    committedEnd = scanCommitted(path, [this, &apply](const vector<json>& batch) {
+        if (apply) {
+            for (const auto& record : batch) apply(record);
+        }
+        records += batch.size();
+        batches++;
+    });
+
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw FileException("Failed to open delta log: " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && static_cast<uint64_t>(st.st_size) > committedEnd) {
+        if (ftruncate(fd, static_cast<off_t>(committedEnd)) != 0) {
+            throw FileException("Failed to truncate delta log: " + path);
+        }
+    }
+}
+
+DeltaLog::~DeltaLog()
+{
+    if (fd >= 0) ::close(fd);
+}
+
+void DeltaLog::appendBatch(const vector<string>& lines, bool syncNow)
+{
+    if (lines.empty()) return;
+
+    string buffer;
+    for (const auto& line : lines) {
+        buffer += line;
+        buffer += '\n';
+    }
+    buffer += "{\"commit\":" + to_string(lines.size()) + "}\n";
+
+    // A failed write can leave part of a batch behind. It is cut off before the next
+    // batch: loading stops at the first broken line, so every batch after it would be
+    // dropped with it.
+    if (tornTail && ftruncate(fd, static_cast<off_t>(committedEnd)) != 0) {
+        throw FileException("Failed to truncate torn delta log tail: " + path);
+    }
+    tornTail = false;
+    try {
+        writeAll(fd, buffer.data(), buffer.size(), path);
+    } catch (const FileException&) {
+        tornTail = ftruncate(fd, static_cast<off_t>(committedEnd)) != 0;
+        throw;
+    }
+    committedEnd += buffer.size();
+    records += lines.size();
+    batches++;
+    if (syncNow) sync();
+}
+
+void DeltaLog::sync()
+{
+    if (fdatasync(fd) != 0) {
+        throw FileException("Failed to sync delta log: " + path);
+    }
+}
+
+void DeltaLog::reset()
+{
+    if (ftruncate(fd, 0) != 0) {
+        throw FileException("Failed to reset delta log: " + path);
+    }
+    records = 0;
+    batches = 0;
+    committedEnd = 0;
+    tornTail = false;
+}
+
+string DeltaLog::pathFor(const string& basePath)
+{
+    const string suffix = ".json";
+    if (basePath.size() > suffix.size() &&
+        basePath.compare(basePath.size() - suffix.size(), suffix.size(), suffix) == 0) {
+        return basePath.substr(0, basePath.size() - suffix.size()) + ".delta";
+    }
+    return basePath + ".delta";
+}
+
+void Banking::writeFileAtomically(const string& path, const string& content, bool syncNow)
+{
+    string tmpPath = path + ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw FileException("Failed to open " + tmpPath + " for writing");
+    }
+    try {
+        writeAll(fd, content.data(), content.size(), tmpPath);
+        if (syncNow && fsync(fd) != 0) {
+            throw FileException("Failed to sync " + tmpPath);
+        }
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+        throw FileException("Failed to replace " + path);
+    }
+}
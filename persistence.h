@@ -0,0 +1,80 @@
+#ifndef PERSISTENCE_H
+#define PERSISTENCE_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// ----------------------------Group-commit persistence for account state--------------------------------
+//
+// accounts.json is the base image of the book. Changes made after it was written go to
+// an append-only delta log next to it (accounts.json -> accounts.delta): one JSON line
+// per changed account followed by a {"commit": n} line that closes the batch. Loading
+// applies the base and then every committed batch; a batch cut short by a crash has no
+// commit line and is dropped. Once the delta log outgrows the book it is folded back
+// into the base image (compaction), so writes stay proportional to the change rate.
+
+namespace Banking
+{
+    // When the delta log is forced to stable storage
+    enum class Durability
+    {
+        EveryBatch,     // fsync after every batch
+        Interval,       // fsync at most once per syncInterval
+        None            // leave it to the OS
+    };
+
+    struct PersistenceOptions
+    {
+        size_t batchSize = 64;                                  // flush once this many accounts are dirty
+        std::chrono::milliseconds flushInterval{500};           // ... or once the oldest change is this old
+        Durability durability = Durability::EveryBatch;
+        std::chrono::milliseconds syncInterval{1000};           // fsync period for Durability::Interval
+        size_t compactionMinRecords = 1024;                     // delta size that never triggers compaction
+        uint64_t checkpointBytes = 1 << 20;                     // journal growth between balance checkpoints, 0 = none
+        int archiveAfterDays = 30;                              // journal days older than this are archived, 0 = never
+    };
+
+    class DeltaLog
+    {
+    private:
+        std::string path;
+        int fd;
+        size_t records;         // committed account lines currently in the log
+        uint64_t batches;
+        uint64_t committedEnd;  // end of the last committed batch
+        bool tornTail;          // a failed write left bytes past committedEnd that are still to be cut
+
+    public:
+        // Opens (or creates) the log, hands every record of every committed batch to
+        // apply (when given) in order and truncates an uncommitted tail
+        explicit DeltaLog(const std::string& logPath,
+                          const std::function<void(const nlohmann::json&)>& apply = nullptr);
+        ~DeltaLog();
+
+        DeltaLog(const DeltaLog&) = delete;
+        DeltaLog& operator=(const DeltaLog&) = delete;
+
+        // Write one batch of serialized JSON objects with a single write call
+        void appendBatch(const std::vector<std::string>& lines, bool syncNow);
+        void sync();
+
+        // Empty the log after its contents were folded into the base image
+        void reset();
+
+        size_t recordCount() const { return records; }
+        const std::string& getPath() const { return path; }
+
+        // Delta log path that belongs to a base file (accounts.json -> accounts.delta)
+        static std::string pathFor(const std::string& basePath);
+    };
+
+    // Replace path with content through a temporary file and rename, so readers see
+    // either the old or the new file and never a half-written one
+    void writeFileAtomically(const std::string& path, const std::string& content, bool syncNow);
+}
+
+#endif // PERSISTENCE_H
@@ -0,0 +1,70 @@
+// ----------------------------Transaction query implementation--------------------------------
+
+#include "bank.h"
+#include "query.h"
+#include "segment.h"
+
+using namespace Banking;
+using namespace Banking::Exceptions;
+
+namespace
+{
+    // False when no record of the segment can match: dated outside the range, or none of
+    // the filter's type
+    bool segmentMayMatch(const TransactionFilter& filter, const SegmentFooter& segment)
+    {
+        if (segment.maxDate < filter.from || segment.minDate > filter.to) return false;
+        return filter.transactionType.empty() || segment.typeCounts[segmentTypeOf(filter.transactionType)] > 0;
+    }
+}
+
+bool Banking::matchesFilter(const TransactionFilter& filter, const JournalRecord& record)
+{
+    if (!filter.account.empty() && record.fromAccount != filter.account && record.toAccount != filter.account) {
+        return false;
+    }
+    if (!filter.transactionType.empty() && record.transactionType != filter.transactionType) return false;
+    if (!filter.status.empty() && record.status != filter.status) return false;
+    if (record.date < filter.from || record.date > filter.to) return false;
+    Money amount;
+    try {
+        amount = Money::fromDouble(record.amount);
+    } catch (const exception&) {
+        // A legacy amount no Money holds (too large, or not a number) lies past every
+        // bound, so it matches only when the filter leaves that side open
+        bool openBelow = filter.minAmount == Money::fromMinor(INT64_MIN);
+        bool openAbove = filter.maxAmount == Money::fromMinor(INT64_MAX);
+        if (record.amount > 0) return openAbove;
+        if (record.amount < 0) return openBelow;
+        return openBelow && openAbove;
+    }
+    return amount >= filter.minAmount && amount <= filter.maxAmount;
+}
+
+TransactionPage Banking::queryTransactions(const string& journalPath, const TransactionFilter& filter,
+                                           uint64_t cursor, size_t limit,
+                                           const function<void(const JournalRecord&)>& fn)
+{
+    TransactionPage page;
+    if (limit == 0) return page;
+
+    // Stops on the first match past the page, which the next page starts with
+    auto take = [&](const JournalRecord& record, uint64_t) {
+        page.examined++;
+        if (!matchesFilter(filter, record)) return true;
+        if (page.count == limit) return false;
+        fn(record);
+        page.count++;
+        return true;
+    };
+    TransactionJournal& journal = TransactionJournal::shared(journalPath);
+    if (!filter.account.empty()) {
+        page.next = journal.walkAccountBackward(filter.account, cursor, take);
+    } else {
+        page.next = journal.walkBackward(cursor, [&filter](const SegmentFooter& segment) {
+            return segmentMayMatch(filter, segment);
+        }, take);
+    }
+    page.more = page.next != TransactionJournal::exhausted;
+    return page;
+}
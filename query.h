@@ -0,0 +1,55 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "journal.h"
+#include "money.h"
+
+// ----------------------------Transaction queries--------------------------------
+//
+// Filtered, paged reads of the transaction journal, newest first. A page holds at most
+// limit matching records and ends with a cursor the next page starts from, so a reader
+// walks any history one screen at a time in constant memory. With an account in the
+// filter the walk follows that account's chain in the journal index and reads nothing
+// else; otherwise it walks the journal backward a segment at a time, skipping the
+// segments whose dates or per-type counts (see segment.h) rule out every match.
+//
+// A cursor is only meaningful with the filter that produced it. Records appended after
+// the first page come first in the next first page, never in the middle of a walk.
+
+namespace Banking
+{
+    struct TransactionFilter
+    {
+        std::string account;            // as fromAccount or toAccount; empty matches any
+        std::string transactionType;    // empty matches any
+        std::string status;             // empty matches any
+        Money minAmount = Money::fromMinor(INT64_MIN);
+        Money maxAmount = Money::fromMinor(INT64_MAX);
+        int64_t from = INT64_MIN;       // dates, inclusive
+        int64_t to = INT64_MAX;
+    };
+
+    struct TransactionPage
+    {
+        size_t count = 0;               // records handed over
+        size_t examined = 0;            // records read to find them
+        bool more = false;              // another page follows
+        uint64_t next = 0;              // cursor of the next page, when there is one
+    };
+
+    const uint64_t firstPage = TransactionJournal::newest;
+
+    bool matchesFilter(const TransactionFilter& filter, const JournalRecord& record);
+
+    // Hand fn the page of at most limit records matching filter that starts at cursor
+    // (firstPage for the newest records), newest first
+    TransactionPage queryTransactions(const std::string& journalPath, const TransactionFilter& filter,
+                                      uint64_t cursor, size_t limit,
+                                      const std::function<void(const JournalRecord&)>& fn);
+}
+
+#endif // QUERY_H
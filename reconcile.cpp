@@ -0,0 +1,337 @@
+// ----------------------------Journal reconciliation implementation--------------------------------
+
+#include "bank.h"
+#include "reconcile.h"
+#include "segment.h"
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+
+using namespace Banking;
+using namespace Banking::Exceptions;
+
+namespace
+{
+    const size_t blockBytes = 4 << 20;          // larger than any frame (see maxPayloadSize)
+    const size_t partitionsPerThread = 8;
+    const size_t queuedBlocksPerThread = 2;     // bounds the memory between reader and workers
+
+    using Totals = unordered_map<string, Money>;
+
+    // Whole frames: a slice of a sealed segment's mapping, or bytes read from the file
+    struct Block
+    {
+        shared_ptr<const MappedSegment> mapping;    // keeps the slice mapped
+        vector<char> bytes;
+        const char* data = nullptr;
+        size_t size = 0;
+    };
+
+    // Frame-aligned journal blocks on their way from the reader to the workers
+    class BlockQueue
+    {
+    private:
+        mutex lock;
+        condition_variable notEmpty;
+        condition_variable notFull;
+        deque<Block> blocks;
+        size_t capacity;
+        bool closed;
+
+    public:
+        explicit BlockQueue(size_t maxBlocks) : capacity(maxBlocks), closed(false) {}
+
+        void push(Block&& block)
+        {
+            unique_lock<mutex> guard(lock);
+            notFull.wait(guard, [this] { return blocks.size() < capacity; });
+            blocks.push_back(move(block));
+            notEmpty.notify_one();
+        }
+
+        // False once the queue is closed and empty
+        bool pop(Block& block)
+        {
+            unique_lock<mutex> guard(lock);
+            notEmpty.wait(guard, [this] { return !blocks.empty() || closed; });
+            if (blocks.empty()) return false;
+            block = move(blocks.front());
+            blocks.pop_front();
+            notFull.notify_one();
+            return true;
+        }
+
+        void close()
+        {
+            lock_guard<mutex> guard(lock);
+            closed = true;
+            notEmpty.notify_all();
+        }
+    };
+
+    // Slice the sealed segments before journalEnd into blocks of whole frames without
+    // copying them. Returns where the file has to be read from; sets stop at a frame
+    // header that cannot be valid (nothing after it can be framed).
+    uint64_t sliceSegments(const TransactionJournal& journal, uint64_t journalEnd, BlockQueue& queue, bool& stop)
+    {
+        const size_t header = TransactionJournal::frameHeaderSize;
+        vector<SegmentFooter> sealed = journal.segments();
+        uint64_t offset = 0;
+        for (size_t i = 0; i < sealed.size() && sealed[i].endOffset <= journalEnd; i++) {
+            shared_ptr<const MappedSegment> mapping = journal.mapSegment(i);
+            size_t sliceStart = 0;
+            size_t pos = 0;
+            while (pos < mapping->size()) {
+                uint32_t length = 0;
+                if (pos + header <= mapping->size()) memcpy(&length, mapping->data() + pos, sizeof(length));
+                if (length == 0 || length > TransactionJournal::maxPayloadSize || pos + header + length > mapping->size()) {
+                    stop = true;
+                    break;
+                }
+                pos += header + length;
+                if (pos - sliceStart >= blockBytes || pos == mapping->size()) {
+                    Block block;
+                    block.mapping = mapping;
+                    block.data = mapping->data() + sliceStart;
+                    block.size = pos - sliceStart;
+                    queue.push(move(block));
+                    sliceStart = pos;
+                }
+            }
+            if (stop) return offset;
+            offset = sealed[i].endOffset;
+        }
+        return offset;
+    }
+
+    // Cut the journal into blocks that end on a frame boundary: the sealed segments from
+    // their mappings, the rest read from the file. Stops at journalEnd, at a frame header
+    // that cannot be valid, or at a torn record at the end of the file.
+    void readBlocks(const string& journalPath, uint64_t journalEnd, BlockQueue& queue)
+    {
+        bool stop = false;
+        uint64_t offset = sliceSegments(TransactionJournal::shared(journalPath), journalEnd, queue, stop);
+        if (stop) {
+            queue.close();
+            return;
+        }
+
+        vector<char> streamBuffer(1 << 16);
+        ifstream file;
+        file.rdbuf()->pubsetbuf(streamBuffer.data(), streamBuffer.size());
+        file.open(journalPath, ios::binary);
+        if (!file.is_open()) {
+            queue.close();
+            return;
+        }
+
+        const size_t header = TransactionJournal::frameHeaderSize;
+        file.seekg(static_cast<streamoff>(offset));
+        vector<char> carry;         // offset: file offset of the first byte of the next block
+        while (!stop) {
+            vector<char> block(blockBytes);
+            size_t have = carry.size();
+            copy(carry.begin(), carry.end(), block.begin());     // unlike memcpy, fine while carry is empty
+            file.read(block.data() + have, static_cast<streamsize>(blockBytes - have));
+            size_t got = have + static_cast<size_t>(file.gcount());
+            if (got == have) break;                 // end of file; a partial frame is torn
+
+            size_t pos = 0;
+            while (pos + header <= got) {
+                uint32_t length;
+                memcpy(&length, block.data() + pos, sizeof(length));
+                if (length == 0 || length > TransactionJournal::maxPayloadSize || offset + pos >= journalEnd) {
+                    stop = true;
+                    break;
+                }
+                if (pos + header + length > got) break;
+                pos += header + length;
+            }
+            carry.assign(block.begin() + pos, block.begin() + got);
+            block.resize(pos);
+            offset += pos;
+            if (!block.empty()) {
+                Block next;
+                next.bytes = move(block);
+                next.data = next.bytes.data();
+                next.size = next.bytes.size();
+                queue.push(move(next));
+            }
+        }
+        queue.close();
+    }
+
+    struct WorkerState
+    {
+        vector<Totals> partitions;
+        size_t records = 0;
+        size_t corrupt = 0;
+    };
+
+    // Check, decode and sum every frame of one block into the worker's partitions
+    void replayBlock(const Block& block, WorkerState& state, JournalRecord& record)
+    {
+        const size_t header = TransactionJournal::frameHeaderSize;
+        hash<string> hasher;
+        size_t pos = 0;
+        while (pos < block.size) {
+            uint32_t length, crc;
+            memcpy(&length, block.data + pos, sizeof(length));
+            memcpy(&crc, block.data + pos + sizeof(length), sizeof(crc));
+            const char* payload = block.data + pos + header;
+            pos += header + length;
+            state.records++;
+            if (TransactionJournal::checksum(payload, length) != crc
+                || !TransactionJournal::decode(payload, length, record)) {
+                state.corrupt++;
+                continue;
+            }
+            if (record.status != "Completed" || record.fromAccount == record.toAccount) continue;
+
+            Money amount = Money::fromDouble(record.amount);
+            if (!isExternalParty(record.fromAccount)) {
+                state.partitions[hasher(record.fromAccount) % state.partitions.size()][record.fromAccount] -= amount;
+            }
+            if (!isExternalParty(record.toAccount)) {
+                state.partitions[hasher(record.toAccount) % state.partitions.size()][record.toAccount] += amount;
+            }
+        }
+    }
+
+    struct ReportLine
+    {
+        string account;
+        string text;
+    };
+}
+
+bool Banking::isExternalParty(const string& name)
+{
+    return name == "Bank" || name == "Settlement";
+}
+
+ReconcileSummary Banking::reconcileJournal(const string& journalPath, const ReconcileRequest& request)
+{
+    auto start = chrono::steady_clock::now();
+    ReconcileSummary summary;
+    summary.accounts = request.balances.size();
+    summary.threads = request.threads > 0 ? request.threads : max(1u, thread::hardware_concurrency());
+    summary.partitions = summary.threads * partitionsPerThread;
+
+    ofstream report(request.reportPath, ios::binary | ios::trunc);
+    if (!report.is_open()) {
+        throw FileException("Cannot write reconciliation report: " + request.reportPath);
+    }
+
+    // Replay: this thread reads, the workers sum
+    vector<WorkerState> states(summary.threads);
+    BlockQueue queue(summary.threads * queuedBlocksPerThread);
+    mutex failureMutex;
+    string failure;
+    vector<thread> workers;
+    for (size_t t = 0; t < summary.threads; t++) {
+        states[t].partitions.resize(summary.partitions);
+        workers.emplace_back([&, t]() {
+            JournalRecord record;
+            Block block;
+            while (queue.pop(block)) {
+                try {
+                    replayBlock(block, states[t], record);
+                } catch (const exception& e) {
+                    // Keep draining so the reader never waits on a full queue
+                    lock_guard<mutex> lock(failureMutex);
+                    if (failure.empty()) failure = e.what();
+                }
+            }
+        });
+    }
+    try {
+        readBlocks(journalPath, request.journalEnd, queue);
+    } catch (...) {
+        queue.close();
+        for (auto& w : workers) w.join();
+        throw;
+    }
+    for (auto& w : workers) w.join();
+    if (!failure.empty()) throw TransactionException("Reconciliation failed: " + failure);
+    for (const auto& state : states) {
+        summary.journalRecords += state.records;
+        summary.corruptRecords += state.corrupt;
+    }
+    summary.replayMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    // Merge and compare partition by partition
+    vector<vector<const pair<string, Money>*>> bookOf(summary.partitions);
+    hash<string> hasher;
+    for (const auto& entry : request.balances) {
+        bookOf[hasher(entry.first) % summary.partitions].push_back(&entry);
+    }
+    vector<vector<ReportLine>> lines(summary.partitions);
+    vector<Money> bookTotals(summary.partitions), journalTotals(summary.partitions);
+    atomic<size_t> nextPartition(0), matched(0), mismatched(0), notInBook(0);
+    auto compare = [&]() {
+        for (size_t p = nextPartition++; p < summary.partitions; p = nextPartition++) {
+            try {
+                Totals merged = move(states[0].partitions[p]);
+                for (size_t t = 1; t < states.size(); t++) {
+                    for (const auto& entry : states[t].partitions[p]) merged[entry.first] += entry.second;
+                    Totals().swap(states[t].partitions[p]);
+                }
+                for (const auto* entry : bookOf[p]) {
+                    Money journalBalance;
+                    auto it = merged.find(entry->first);
+                    if (it != merged.end()) {
+                        journalBalance = it->second;
+                        merged.erase(it);
+                    }
+                    bookTotals[p] += entry->second;
+                    journalTotals[p] += journalBalance;
+                    Money difference = entry->second - journalBalance;
+                    if (difference <= request.tolerance && -difference <= request.tolerance) {
+                        matched++;
+                        continue;
+                    }
+                    mismatched++;
+                    lines[p].push_back({entry->first, entry->first + "," + entry->second.toString() + ","
+                                        + journalBalance.toString() + "," + difference.toString() + ",mismatch"});
+                }
+                for (const auto& entry : merged) {
+                    if (entry.second == Money()) continue;
+                    notInBook++;
+                    lines[p].push_back({entry.first, entry.first + ",0.00," + entry.second.toString() + ","
+                                        + (-entry.second).toString() + ",not_in_book"});
+                }
+            } catch (const exception& e) {
+                lock_guard<mutex> lock(failureMutex);
+                if (failure.empty()) failure = e.what();
+            }
+        }
+    };
+    vector<thread> pool;
+    for (size_t t = 1; t < summary.threads; t++) pool.emplace_back(compare);
+    compare();
+    for (auto& t : pool) t.join();
+    if (!failure.empty()) throw TransactionException("Reconciliation failed: " + failure);
+
+    summary.matched = matched;
+    summary.mismatched = mismatched;
+    summary.notInBook = notInBook;
+    for (size_t p = 0; p < summary.partitions; p++) {
+        summary.bookTotal += bookTotals[p];
+        summary.journalTotal += journalTotals[p];
+    }
+
+    vector<ReportLine> all;
+    for (auto& part : lines) {
+        for (auto& line : part) all.push_back(move(line));
+    }
+    sort(all.begin(), all.end(), [](const ReportLine& a, const ReportLine& b) { return a.account < b.account; });
+    report << "account,book_balance,journal_balance,difference,status\n";
+    for (const auto& line : all) report << line.text << "\n";
+    report.close();
+    if (report.fail()) {
+        throw FileException("Cannot write reconciliation report: " + request.reportPath);
+    }
+    summary.elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return summary;
+}
@@ -0,0 +1,66 @@
+#ifndef RECONCILE_H
+#define RECONCILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "money.h"
+
+// ----------------------------Journal reconciliation--------------------------------
+//
+// Rebuilds every account's balance from the transaction journal (credits to toAccount
+// minus debits from fromAccount, "Completed" records only) and compares it with the
+// balance the account table holds. The replay is a pipeline with bounded memory: one
+// thread cuts the journal into frame-aligned blocks and hands them through a small
+// queue to worker threads, which check, decode and sum the records into per-account
+// totals split into hash partitions. The partitions are then merged and compared in
+// parallel. Memory grows with the number of accounts, never with the number of
+// records, so journals of any length stream through. A reconciliation needs every
+// record, so no segment is skipped (see segment.h), but the sealed ones reach the
+// workers as slices of their shared read-only mappings instead of copies.
+//
+// The report is a CSV of every account that does not match:
+//
+//     account,book_balance,journal_balance,difference,status
+//
+// with status "mismatch" (in the book, balances differ) or "not_in_book" (the journal
+// moves money for an account the book does not hold).
+
+namespace Banking
+{
+    struct ReconcileRequest
+    {
+        std::vector<std::pair<std::string, Money>> balances;    // the account table
+        std::string reportPath;
+        size_t threads = 0;                 // 0 = one per hardware thread
+        Money tolerance;                    // differences up to this are a match
+        uint64_t journalEnd = UINT64_MAX;   // records at or past this offset are ignored
+    };
+
+    struct ReconcileSummary
+    {
+        size_t accounts = 0;                // accounts in the book
+        size_t matched = 0;
+        size_t mismatched = 0;
+        size_t notInBook = 0;
+        size_t journalRecords = 0;
+        size_t corruptRecords = 0;          // frames failing their checksum (skipped)
+        Money bookTotal;
+        Money journalTotal;                 // over the accounts in the book
+        size_t threads = 0;
+        size_t partitions = 0;
+        double replayMs = 0;
+        double elapsedMs = 0;
+    };
+
+    // Pseudo-accounts that stand for money entering or leaving the bank, not accounts
+    bool isExternalParty(const std::string& name);
+
+    // Reconcile request.balances against the journal at journalPath. Throws
+    // FileException when the report cannot be written.
+    ReconcileSummary reconcileJournal(const std::string& journalPath, const ReconcileRequest& request);
+}
+
+#endif // RECONCILE_H
@@ -0,0 +1,153 @@
+// ----------------------------Streaming JSON record reader implementation--------------------------------
+
+#include "bank.h"
+#include "sax_loader.h"
+
+using namespace Banking;
+using namespace Banking::Exceptions;
+
+SaxRecordReader::SaxRecordReader(FieldHandler fieldHandler, RecordHandler recordHandler)
+    : onField(move(fieldHandler)), onRecord(move(recordHandler)), depth(0), skippedArrays(0)
+{
+}
+
+bool SaxRecordReader::parseFile(const std::string& path)
+{
+    vector<char> streamBuffer(1 << 16);
+    ifstream file;
+    file.rdbuf()->pubsetbuf(streamBuffer.data(), streamBuffer.size());
+    file.open(path, ios::binary);
+    if (!file.is_open()) return false;
+
+    keys.clear();
+    depth = 0;
+    skippedArrays = 0;
+    error.clear();
+    if (!json::sax_parse(file, this) || !error.empty()) {
+        throw FileException("Error reading " + path + ": " + (error.empty() ? "unexpected structure" : error));
+    }
+    return true;
+}
+
+// Hand the current scalar to the field handler under its dotted path
+void SaxRecordReader::emit()
+{
+    if (depth < 2 || skippedArrays > 0) return;
+
+    std::string path;
+    for (const auto& k : keys) {
+        path += k;
+        path += '.';
+    }
+    path += pendingKey;
+    onField(path, value);
+}
+
+bool SaxRecordReader::null()
+{
+    value.kind = SaxValue::Null;
+    emit();
+    return true;
+}
+
+bool SaxRecordReader::boolean(bool val)
+{
+    value.kind = SaxValue::Boolean;
+    value.boolean = val;
+    emit();
+    return true;
+}
+
+bool SaxRecordReader::number_integer(number_integer_t val)
+{
+    value.kind = SaxValue::Integer;
+    value.integer = val;
+    emit();
+    return true;
+}
+
+bool SaxRecordReader::number_unsigned(number_unsigned_t val)
+{
+    value.kind = SaxValue::Integer;
+    value.integer = static_cast<int64_t>(val);
+    emit();
+    return true;
+}
+
+bool SaxRecordReader::number_float(number_float_t val, const string_t& literal)
+{
+    value.kind = SaxValue::Float;
+    value.number = val;
+    value.text = literal;
+    emit();
+    return true;
+}
+
+bool SaxRecordReader::string(string_t& val)
+{
+    value.kind = SaxValue::String;
+    value.text.swap(val);
+    emit();
+    return true;
+}
+
+bool SaxRecordReader::binary(binary_t&)
+{
+    return true;
+}
+
+bool SaxRecordReader::start_object(std::size_t)
+{
+    if (skippedArrays > 0) return true;
+    if (depth == 0) {
+        error = "expected an array of objects";
+        return false;
+    }
+    if (depth >= 2) keys.push_back(pendingKey);
+    depth++;
+    return true;
+}
+
+bool SaxRecordReader::key(string_t& val)
+{
+    if (skippedArrays == 0) pendingKey.swap(val);
+    return true;
+}
+
+bool SaxRecordReader::end_object()
+{
+    if (skippedArrays > 0) return true;
+    depth--;
+    if (depth == 1) {
+        onRecord();
+    } else if (!keys.empty()) {
+        keys.pop_back();
+    }
+    return true;
+}
+
+bool SaxRecordReader::start_array(std::size_t)
+{
+    if (depth == 0) {
+        depth = 1;
+    } else {
+        skippedArrays++;      // arrays inside a record are not part of any loaded type
+    }
+    return true;
+}
+
+bool SaxRecordReader::end_array()
+{
+    if (skippedArrays > 0) {
+        skippedArrays--;
+    } else {
+        depth = 0;
+    }
+    return true;
+}
+
+bool SaxRecordReader::parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex)
+{
+    error = ex.what();
+    return false;
+}
@@ -0,0 +1,77 @@
+#ifndef SAX_LOADER_H
+#define SAX_LOADER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// ----------------------------Streaming JSON record reader--------------------------------
+//
+// Reads files shaped like accounts.json, users.json and employees.json (a top-level
+// array of objects) straight from the token stream. Every scalar inside an element is
+// reported with its dotted path ("balance", "customerInfo.name") and the end of each
+// element is signalled, so callers build their objects field by field and no json DOM
+// is ever materialized. Memory use is one record plus the parser's small buffers.
+
+namespace Banking
+{
+    // One scalar value from the stream
+    struct SaxValue
+    {
+        enum Kind { Null, Boolean, Integer, Float, String };
+
+        Kind kind = Null;
+        bool boolean = false;
+        int64_t integer = 0;
+        double number = 0.0;
+        std::string text;       // a String, or the literal of a Float as written
+
+        bool isNumber() const { return kind == Integer || kind == Float; }
+        double asDouble() const { return kind == Integer ? static_cast<double>(integer) : number; }
+    };
+
+    class SaxRecordReader : public nlohmann::json_sax<nlohmann::json>
+    {
+    public:
+        using FieldHandler = std::function<void(const std::string& path, const SaxValue& value)>;
+        using RecordHandler = std::function<void()>;
+
+    private:
+        FieldHandler onField;
+        RecordHandler onRecord;
+        std::vector<std::string> keys;      // object keys from the record down to the current value
+        std::string pendingKey;
+        int depth;                          // 1 inside the top-level array, 2 inside a record
+        int skippedArrays;                  // nesting level of arrays inside a record (ignored)
+        std::string error;
+        SaxValue value;
+
+        void emit();
+
+    public:
+        SaxRecordReader(FieldHandler fieldHandler, RecordHandler recordHandler);
+
+        // Stream path through the handlers. Returns false when the file does not
+        // exist; throws FileException when it is not a well-formed array of objects.
+        bool parseFile(const std::string& path);
+
+        bool null() override;
+        bool boolean(bool val) override;
+        bool number_integer(number_integer_t val) override;
+        bool number_unsigned(number_unsigned_t val) override;
+        bool number_float(number_float_t val, const string_t& literal) override;
+        bool string(string_t& val) override;
+        bool binary(binary_t& val) override;
+        bool start_object(std::size_t elements) override;
+        bool key(string_t& val) override;
+        bool end_object() override;
+        bool start_array(std::size_t elements) override;
+        bool end_array() override;
+        bool parse_error(std::size_t position, const std::string& lastToken,
+                         const nlohmann::detail::exception& ex) override;
+    };
+}
+
+#endif // SAX_LOADER_H
@@ -0,0 +1,178 @@
+// ----------------------------Journal segment implementation--------------------------------
+
+#include "bank.h"
+#include "segment.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Banking;
+using namespace Banking::Exceptions;
+
+namespace
+{
+    const uint32_t footerVersion = 1;
+    const char* const typeNames[SegmentTypeCount] = {
+        "Deposit", "Withdrawal", "Transfer", "Salary", "Zakat", "Interest", "Settlement", "Other"
+    };
+
+    uint32_t footerChecksum(const SegmentFooter& footer)
+    {
+        return TransactionJournal::checksum(reinterpret_cast<const char*>(&footer),
+                                            offsetof(SegmentFooter, checksum));
+    }
+
+    SegmentFooter emptySegment(uint64_t startOffset)
+    {
+        SegmentFooter footer = {};
+        footer.startOffset = startOffset;
+        footer.minDate = INT64_MAX;
+        footer.maxDate = INT64_MIN;
+        return footer;
+    }
+
+    int64_t dayOf(int64_t date)
+    {
+        int64_t day = date / SegmentCatalog::segmentSeconds;
+        return date % SegmentCatalog::segmentSeconds < 0 ? day - 1 : day;
+    }
+
+    void writeAll(int fd, const char* data, size_t length, uint64_t offset, const string& path)
+    {
+        while (length > 0) {
+            ssize_t n = ::pwrite(fd, data, length, static_cast<off_t>(offset));
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw FileException("Write to " + path + " failed: " + strerror(errno));
+            }
+            data += n;
+            offset += static_cast<uint64_t>(n);
+            length -= static_cast<size_t>(n);
+        }
+    }
+}
+
+SegmentType Banking::segmentTypeOf(string_view transactionType)
+{
+    for (int t = 0; t < SegmentOther; t++) {
+        if (transactionType == typeNames[t]) return static_cast<SegmentType>(t);
+    }
+    return SegmentOther;
+}
+
+const char* Banking::segmentTypeName(SegmentType type)
+{
+    return type < SegmentTypeCount ? typeNames[type] : "";
+}
+
+SegmentCatalog::SegmentCatalog(const string& catalogPath, uint64_t journalEnd)
+    : path(catalogPath), fd(-1), written(0), open(emptySegment(0)), openDay(0)
+{
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw FileException("Failed to open segment catalog: " + path);
+    }
+
+    // Keep footers while they follow each other through the journal without a gap
+    SegmentFooter footer;
+    uint64_t next = 0;
+    while (pread(fd, &footer, sizeof(footer), static_cast<off_t>(sealed.size() * sizeof(footer)))
+           == static_cast<ssize_t>(sizeof(footer))) {
+        if (footer.version != footerVersion || footer.checksum != footerChecksum(footer)
+            || footer.startOffset != next || footer.endOffset <= footer.startOffset
+            || footer.endOffset > journalEnd || footer.count == 0) {
+            break;
+        }
+        sealed.push_back(footer);
+        next = footer.endOffset;
+    }
+    if (ftruncate(fd, static_cast<off_t>(sealed.size() * sizeof(footer))) != 0) {
+        throw FileException("Failed to truncate segment catalog: " + path);
+    }
+    written = sealed.size();
+    open = emptySegment(next);
+}
+
+SegmentCatalog::~SegmentCatalog()
+{
+    if (fd >= 0) ::close(fd);
+}
+
+void SegmentCatalog::add(uint64_t offset, int64_t date, string_view transactionType)
+{
+    if (open.count > 0 && dayOf(date) > openDay) {
+        open.endOffset = offset;
+        open.version = footerVersion;
+        open.checksum = footerChecksum(open);
+        sealed.push_back(open);
+        open = emptySegment(offset);
+    }
+    if (open.count == 0) openDay = dayOf(date);
+    open.minDate = min(open.minDate, date);
+    open.maxDate = max(open.maxDate, date);
+    open.count++;
+    open.typeCounts[segmentTypeOf(transactionType)]++;
+
+    // The catalog in memory is complete before anything is written, and footers are
+    // written at their place in the file, so a failed write only leaves the file behind:
+    // its footers go out again with the next record, or are rebuilt from the journal on
+    // the next open
+    if (written < sealed.size()) {
+        writeAll(fd, reinterpret_cast<const char*>(&sealed[written]), (sealed.size() - written) * sizeof(SegmentFooter),
+                 written * sizeof(SegmentFooter), path);
+        written = sealed.size();
+    }
+}
+
+string SegmentCatalog::pathFor(const string& journalPath)
+{
+    const string suffix = ".journal";
+    if (journalPath.size() > suffix.size() &&
+        journalPath.compare(journalPath.size() - suffix.size(), suffix.size(), suffix) == 0) {
+        return journalPath.substr(0, journalPath.size() - suffix.size()) + ".segments";
+    }
+    return journalPath + ".segments";
+}
+
+MappedSegment::MappedSegment(int fd, uint64_t start, uint64_t end)
+    : base(MAP_FAILED), mappedLength(0), records(nullptr), length(end - start), startOffset(start)
+{
+    // mmap wants a page-aligned file offset; map from the page the segment starts in
+    uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    uint64_t aligned = start - start % page;
+    mappedLength = static_cast<size_t>(end - aligned);
+    base = mmap(nullptr, mappedLength, PROT_READ, MAP_SHARED, fd, static_cast<off_t>(aligned));
+    if (base == MAP_FAILED) {
+        throw FileException(string("Failed to map journal segment: ") + strerror(errno));
+    }
+    madvise(base, mappedLength, MADV_SEQUENTIAL);
+    records = static_cast<const char*>(base) + (start - aligned);
+}
+
+MappedSegment::~MappedSegment()
+{
+    if (base != MAP_FAILED) munmap(base, mappedLength);
+}
+
+bool MappedSegment::forEach(const function<bool(const JournalRecord&, uint64_t)>& fn) const
+{
+    const size_t header = TransactionJournal::frameHeaderSize;
+    JournalRecord record;
+    size_t pos = 0;
+    while (pos + header <= length) {
+        uint32_t frame[2];
+        memcpy(frame, records + pos, sizeof(frame));
+        if (frame[0] == 0 || frame[0] > TransactionJournal::maxPayloadSize || pos + header + frame[0] > length) break;
+        const char* payload = records + pos + header;
+        if (TransactionJournal::checksum(payload, frame[0]) != frame[1]
+            || !TransactionJournal::decode(payload, frame[0], record)) {
+            break;
+        }
+        if (!fn(record, startOffset + pos)) return false;
+        pos += header + frame[0];
+    }
+    return true;
+}
@@ -0,0 +1,121 @@
+#ifndef SEGMENT_H
+#define SEGMENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "journal.h"
+
+// ----------------------------Journal segments--------------------------------
+//
+// The journal is cut into daily segments: consecutive byte ranges of the journal file,
+// each closed (sealed) when the first record of a later day (UTC, by record date) is
+// appended. A sealed segment never changes again. Its footer — byte range, earliest
+// and latest date, record count and a count per transaction type — goes to a catalog
+// next to the journal (transactions.journal -> transactions.segments), one fixed-width
+// footer per segment with its own CRC-32. Date-range readers skip every segment whose
+// dates cannot match, and read the others through read-only mappings that any number
+// of threads share.
+//
+// Records are appended in commit order, so one queued across midnight can land in the
+// next day's segment; the footer dates cover it, which is all pruning relies on. The
+// catalog is derived data and is never synced: footers past the journal's end are
+// dropped on open, and the journal after the last footer (the open segment, or all of
+// it the first time) is segmented again by the scan that opens the journal.
+
+namespace Banking
+{
+    enum SegmentType
+    {
+        SegmentDeposit = 0, SegmentWithdrawal, SegmentTransfer, SegmentSalary,
+        SegmentZakat, SegmentInterest, SegmentSettlement, SegmentOther, SegmentTypeCount
+    };
+
+    // Counter a transactionType is counted under
+    SegmentType segmentTypeOf(std::string_view transactionType);
+    const char* segmentTypeName(SegmentType type);
+
+    struct SegmentFooter
+    {
+        uint64_t startOffset;       // journal bytes [startOffset, endOffset)
+        uint64_t endOffset;
+        int64_t minDate;
+        int64_t maxDate;
+        uint64_t count;
+        uint64_t typeCounts[SegmentTypeCount];
+        uint32_t version;
+        uint32_t checksum;          // CRC-32 of every byte before this field
+    };
+
+    // Sealed footers plus the open segment being appended to. Not thread-safe: the
+    // journal serializes every call.
+    class SegmentCatalog
+    {
+    private:
+        std::string path;
+        int fd;
+        std::vector<SegmentFooter> sealed;
+        size_t written;             // footers of sealed in the file
+        SegmentFooter open;         // endOffset stays 0 until it is sealed
+        int64_t openDay;            // day of the open segment's first record
+
+    public:
+        static constexpr int64_t segmentSeconds = 86400;
+
+        // Opens (or creates) the catalog and keeps the footers of segments that end at
+        // or before journalEnd; the open segment starts where the last of them ends
+        SegmentCatalog(const std::string& catalogPath, uint64_t journalEnd);
+        ~SegmentCatalog();
+
+        SegmentCatalog(const SegmentCatalog&) = delete;
+        SegmentCatalog& operator=(const SegmentCatalog&) = delete;
+
+        // Journal offset the open segment starts at
+        uint64_t sealedEnd() const { return open.startOffset; }
+
+        // Note one record, in journal order. Seals the open segment first when the
+        // record is from a later day than the open segment's first record. Throws when
+        // a footer cannot be written; the record is noted all the same.
+        void add(uint64_t offset, int64_t date, std::string_view transactionType);
+
+        const std::vector<SegmentFooter>& sealedSegments() const { return sealed; }
+        // Footer of the open segment so far (count 0 when it is empty)
+        const SegmentFooter& openSegment() const { return open; }
+
+        // Catalog path that belongs to a journal (transactions.journal -> transactions.segments)
+        static std::string pathFor(const std::string& journalPath);
+    };
+
+    // A read-only mapping of journal bytes: a sealed segment, or the open one as far as
+    // it went when it was mapped
+    class MappedSegment
+    {
+    private:
+        void* base;
+        size_t mappedLength;
+        const char* records;
+        size_t length;
+        uint64_t startOffset;
+
+    public:
+        // Map journal bytes [start, end) of the open file descriptor fd
+        MappedSegment(int fd, uint64_t start, uint64_t end);
+        ~MappedSegment();
+
+        MappedSegment(const MappedSegment&) = delete;
+        MappedSegment& operator=(const MappedSegment&) = delete;
+
+        const char* data() const { return records; }
+        size_t size() const { return length; }
+        uint64_t offset() const { return startOffset; }
+
+        // Every intact record in order with its journal offset; fn returns false to
+        // stop. Returns false when fn stopped it.
+        bool forEach(const std::function<bool(const JournalRecord&, uint64_t)>& fn) const;
+    };
+}
+
+#endif // SEGMENT_H
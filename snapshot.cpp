@@ -0,0 +1,213 @@
+// ----------------------------Binary account snapshot implementation--------------------------------
+
+#include "bank.h"
+#include "snapshot.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Banking;
+using namespace Banking::Exceptions;
+
+namespace
+{
+    const char snapshotMagic[8] = {'M', 'D', 'B', 'S', 'N', 'A', 'P', '\0'};
+
+    size_t alignUp(size_t value)
+    {
+        return (value + 7) & ~static_cast<size_t>(7);
+    }
+
+    uint32_t headerChecksum(const SnapshotHeader& header)
+    {
+        return TransactionJournal::checksum(reinterpret_cast<const char*>(&header),
+                                            offsetof(SnapshotHeader, checksum));
+    }
+
+    bool modifiedAt(const string& path, struct timespec& when)
+    {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) return false;
+        when = st.st_mtim;
+        return true;
+    }
+}
+
+AccountSnapshot::AccountSnapshot()
+    : base(nullptr), length(0), header(nullptr), records(nullptr), offsets(nullptr), strings(nullptr)
+{
+}
+
+AccountSnapshot::~AccountSnapshot()
+{
+    close();
+}
+
+bool AccountSnapshot::open(const string& path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+        ::close(fd);
+        return false;
+    }
+    size_t fileSize = static_cast<size_t>(st.st_size);
+    void* mapped = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) return false;
+
+    const SnapshotHeader* h = static_cast<const SnapshotHeader*>(mapped);
+    bool valid = memcmp(h->magic, snapshotMagic, sizeof(snapshotMagic)) == 0
+        && h->version == snapshotVersion
+        && h->headerSize == sizeof(SnapshotHeader)
+        && h->checksum == headerChecksum(*h)
+        && h->fileSize == fileSize
+        && h->recordsOffset + h->count * sizeof(SnapshotRecord) <= h->offsetsOffset
+        && h->offsetsOffset + (h->count * SnapshotFieldCount + 1) * sizeof(uint32_t) <= h->stringsOffset
+        && h->stringsOffset <= fileSize;
+    if (!valid) {
+        munmap(mapped, fileSize);
+        return false;
+    }
+
+    base = static_cast<const char*>(mapped);
+    length = fileSize;
+    header = h;
+    records = reinterpret_cast<const SnapshotRecord*>(base + h->recordsOffset);
+    offsets = reinterpret_cast<const uint32_t*>(base + h->offsetsOffset);
+    strings = base + h->stringsOffset;
+
+    if (h->stringsOffset + offsets[h->count * SnapshotFieldCount] > fileSize) {
+        close();
+        return false;
+    }
+    madvise(const_cast<char*>(base), length, MADV_WILLNEED);
+    return true;
+}
+
+void AccountSnapshot::close()
+{
+    if (base) {
+        munmap(const_cast<char*>(base), length);
+    }
+    base = nullptr;
+    length = 0;
+    header = nullptr;
+    records = nullptr;
+    offsets = nullptr;
+    strings = nullptr;
+}
+
+string_view AccountSnapshot::accountNumber(size_t i) const
+{
+    const char* num = records[i].accountNumber;
+    return string_view(num, strnlen(num, snapshotAccountNumberSize));
+}
+
+string_view AccountSnapshot::field(size_t i, SnapshotField f) const
+{
+    size_t slot = i * SnapshotFieldCount + f;
+    return string_view(strings + offsets[slot], offsets[slot + 1] - offsets[slot]);
+}
+
+long AccountSnapshot::find(const string& accNum) const
+{
+    if (!header || accNum.size() >= snapshotAccountNumberSize) return -1;
+
+    char key[snapshotAccountNumberSize] = {};
+    memcpy(key, accNum.data(), accNum.size());
+
+    size_t lo = 0;
+    size_t hi = size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = memcmp(records[mid].accountNumber, key, snapshotAccountNumberSize);
+        if (cmp == 0) return static_cast<long>(mid);
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return -1;
+}
+
+void AccountSnapshot::write(const string& path, vector<SnapshotEntry>& entries, bool syncNow)
+{
+    sort(entries.begin(), entries.end(), [](const SnapshotEntry& a, const SnapshotEntry& b) {
+        return a.accountNumber < b.accountNumber;
+    });
+
+    size_t count = entries.size();
+    size_t stringBytes = 0;
+    for (const auto& entry : entries) {
+        if (entry.accountNumber.size() >= snapshotAccountNumberSize) {
+            throw FileException("Account number too long for snapshot: " + entry.accountNumber);
+        }
+        for (const auto& f : entry.fields) stringBytes += f.size();
+    }
+    if (stringBytes > UINT32_MAX) {
+        throw FileException("Snapshot string table exceeds 4 GiB");
+    }
+
+    SnapshotHeader header = {};
+    memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+    header.version = snapshotVersion;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.count = count;
+    header.recordsOffset = alignUp(sizeof(SnapshotHeader));
+    header.offsetsOffset = alignUp(header.recordsOffset + count * sizeof(SnapshotRecord));
+    header.stringsOffset = alignUp(header.offsetsOffset + (count * SnapshotFieldCount + 1) * sizeof(uint32_t));
+    header.fileSize = header.stringsOffset + stringBytes;
+    header.createdAt = static_cast<int64_t>(time(nullptr));
+    header.checksum = headerChecksum(header);
+
+    string buffer(header.fileSize, '\0');
+    memcpy(&buffer[0], &header, sizeof(header));
+
+    SnapshotRecord* outRecords = reinterpret_cast<SnapshotRecord*>(&buffer[header.recordsOffset]);
+    uint32_t* outOffsets = reinterpret_cast<uint32_t*>(&buffer[header.offsetsOffset]);
+    char* outStrings = &buffer[header.stringsOffset];
+
+    uint32_t cursor = 0;
+    for (size_t i = 0; i < count; i++) {
+        const SnapshotEntry& entry = entries[i];
+        SnapshotRecord& rec = outRecords[i];
+        memcpy(rec.accountNumber, entry.accountNumber.data(), entry.accountNumber.size());
+        rec.balance = entry.balance;
+        rec.openingDate = entry.openingDate;
+        rec.type = entry.type;
+        rec.accrualDay = entry.accrualDay;
+
+        for (int f = 0; f < SnapshotFieldCount; f++) {
+            outOffsets[i * SnapshotFieldCount + f] = cursor;
+            memcpy(outStrings + cursor, entry.fields[f].data(), entry.fields[f].size());
+            cursor += static_cast<uint32_t>(entry.fields[f].size());
+        }
+    }
+    outOffsets[count * SnapshotFieldCount] = cursor;
+
+    writeFileAtomically(path, buffer, syncNow);
+}
+
+string AccountSnapshot::pathFor(const string& basePath)
+{
+    const string suffix = ".json";
+    if (basePath.size() > suffix.size() &&
+        basePath.compare(basePath.size() - suffix.size(), suffix.size(), suffix) == 0) {
+        return basePath.substr(0, basePath.size() - suffix.size()) + ".snap";
+    }
+    return basePath + ".snap";
+}
+
+bool AccountSnapshot::isCurrent(const string& snapPath, const string& basePath)
+{
+    struct timespec snapTime, baseTime;
+    if (!modifiedAt(snapPath, snapTime)) return false;
+    if (!modifiedAt(basePath, baseTime)) return true;
+    return snapTime.tv_sec > baseTime.tv_sec ||
+           (snapTime.tv_sec == baseTime.tv_sec && snapTime.tv_nsec >= baseTime.tv_nsec);
+}
@@ -0,0 +1,114 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// ----------------------------Binary account snapshot--------------------------------
+//
+// File layout (host byte order, every section 8-byte aligned):
+//
+//     SnapshotHeader
+//     SnapshotRecord[count]          fixed width, sorted by account number
+//     uint32_t offsets[count*4 + 1]  start of field f of record i is offsets[i*4 + f],
+//                                    its end is the next entry
+//     char strings[]                 name, dob, cnic and address of every record
+//
+// The header carries a CRC-32 of its own bytes and the total file size, so a
+// truncated or foreign file is rejected on open. The file is mapped read-only and
+// records are used in place; nothing is parsed.
+
+namespace Banking
+{
+    // 2: SnapshotRecord::accrualDay took over the last four padding bytes
+    // 3: balances in minor units instead of double
+    const uint32_t snapshotVersion = 3;
+    const size_t snapshotAccountNumberSize = 24;
+
+    struct SnapshotHeader
+    {
+        char magic[8];              // "MDBSNAP"
+        uint32_t version;
+        uint32_t headerSize;
+        uint64_t count;
+        uint64_t recordsOffset;
+        uint64_t offsetsOffset;
+        uint64_t stringsOffset;
+        uint64_t fileSize;
+        int64_t createdAt;
+        uint64_t reserved;
+        uint32_t checksum;          // CRC-32 of every header byte before this field
+        uint32_t padding;
+    };
+
+    struct SnapshotRecord
+    {
+        char accountNumber[snapshotAccountNumberSize];   // NUL padded
+        int64_t balance;            // minor units (see money.h)
+        int64_t openingDate;
+        uint8_t type;               // 0 = Saving, 1 = Business
+        uint8_t flags;
+        uint8_t padding[2];
+        int32_t accrualDay;         // last interest accrual day, 0 for never
+    };
+
+    // PersonalInfo string fields in the order they are stored
+    enum SnapshotField { SnapshotName = 0, SnapshotDob, SnapshotCnic, SnapshotAddress, SnapshotFieldCount };
+
+    // One account as handed to the writer
+    struct SnapshotEntry
+    {
+        std::string accountNumber;
+        int64_t balance = 0;        // minor units
+        int64_t openingDate = 0;
+        uint8_t type = 0;
+        int32_t accrualDay = 0;
+        std::string fields[SnapshotFieldCount];
+    };
+
+    class AccountSnapshot
+    {
+    private:
+        const char* base;
+        size_t length;
+        const SnapshotHeader* header;
+        const SnapshotRecord* records;
+        const uint32_t* offsets;
+        const char* strings;
+
+    public:
+        AccountSnapshot();
+        ~AccountSnapshot();
+
+        AccountSnapshot(const AccountSnapshot&) = delete;
+        AccountSnapshot& operator=(const AccountSnapshot&) = delete;
+
+        // Map a snapshot file; false when it is missing or fails validation
+        bool open(const std::string& path);
+        void close();
+        bool isOpen() const { return base != nullptr; }
+
+        size_t size() const { return header ? static_cast<size_t>(header->count) : 0; }
+        const SnapshotHeader& getHeader() const { return *header; }
+        const SnapshotRecord& record(size_t i) const { return records[i]; }
+        std::string_view accountNumber(size_t i) const;
+        std::string_view field(size_t i, SnapshotField f) const;
+
+        // Binary search by account number, returns the record index or -1
+        long find(const std::string& accNum) const;
+
+        // Write entries (sorted here) to path through a temporary file and rename
+        static void write(const std::string& path, std::vector<SnapshotEntry>& entries, bool syncNow);
+
+        // Snapshot path that belongs to a base file (accounts.json -> accounts.snap)
+        static std::string pathFor(const std::string& basePath);
+
+        // True when the snapshot at snapPath exists and is at least as new as basePath
+        static bool isCurrent(const std::string& snapPath, const std::string& basePath);
+    };
+}
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,255 @@
+// ----------------------------Account statement implementation--------------------------------
+
+#include "bank.h"
+#include "statement.h"
+#include <cerrno>
+#include <iomanip>
+#include <sstream>
+#include <sys/stat.h>
+
+using namespace Banking;
+using namespace Banking::Exceptions;
+
+namespace
+{
+    const size_t shardsPerThread = 4;   // a few shards per thread evens out busy accounts
+
+    struct AccountTotals
+    {
+        Money balanceAtEnd;
+        Money afterPeriod;              // credits minus debits after the period
+        size_t shard = 0;
+    };
+
+    string shardPath(const string& dir, size_t shard)
+    {
+        return dir + "/.statement-shard-" + to_string(shard) + ".journal";
+    }
+
+    string formatLocal(time_t when, const char* format)
+    {
+        struct tm local;
+        localtime_r(&when, &local);
+        char buffer[32];
+        strftime(buffer, sizeof(buffer), format, &local);
+        return buffer;
+    }
+
+    // "YYYY-MM-DD HH:MM:SS" in local time. localtime_r takes a process-wide lock, so it
+    // runs once per hour of history: zone offsets change on whole hours, and the
+    // seconds within the hour are added to the cached start.
+    class LocalClock
+    {
+    private:
+        time_t hourStart = -1;
+        struct tm start = {};
+
+    public:
+        void format(time_t when, char* out)     // out holds at least 64 bytes
+        {
+            time_t hour = when - ((when % 3600) + 3600) % 3600;
+            if (hour != hourStart) {
+                localtime_r(&hour, &start);
+                hourStart = hour;
+            }
+            long seconds = start.tm_hour * 3600L + start.tm_min * 60 + start.tm_sec + (when - hour);
+            if (seconds >= 86400) {         // crossed local midnight inside the hour
+                struct tm local;
+                localtime_r(&when, &local);
+                strftime(out, 64, "%Y-%m-%d %H:%M:%S", &local);
+                return;
+            }
+            int clock = static_cast<int>(seconds);
+            snprintf(out, 64, "%04d-%02d-%02d %02d:%02d:%02d", start.tm_year + 1900, start.tm_mon + 1,
+                     start.tm_mday, clock / 3600, clock / 60 % 60, clock % 60);
+        }
+    };
+
+    // Append text padded with spaces to width, on the left when alignRight
+    void appendPadded(string& out, const string& text, size_t width, bool alignRight)
+    {
+        size_t padding = text.size() < width ? width - text.size() : 0;
+        if (alignRight) out.append(padding, ' ');
+        out += text;
+        if (!alignRight) out.append(padding, ' ');
+    }
+
+    // Account numbers become file names; keep them inside the output directory
+    string statementPath(const string& dir, string accNum)
+    {
+        replace(accNum.begin(), accNum.end(), '/', '_');
+        return dir + "/" + accNum + ".txt";
+    }
+
+    void writeStatement(const string& path, const string& accNum, const AccountTotals& totals,
+                        const vector<JournalRecord>& records, vector<uint32_t>& entries,
+                        const StatementRequest& request, LocalClock& clock)
+    {
+        // The journal is nearly in date order already; keep its order for equal dates
+        stable_sort(entries.begin(), entries.end(), [&records](uint32_t a, uint32_t b) {
+            return records[a].date < records[b].date;
+        });
+
+        Money debits, credits;
+        for (uint32_t i : entries) {
+            Money amount = Money::fromDouble(records[i].amount);
+            if (records[i].fromAccount == accNum) debits += amount;
+            else credits += amount;
+        }
+        Money closing = totals.balanceAtEnd - totals.afterPeriod;
+        Money balance = closing - credits + debits;
+
+        ostringstream header;
+        header << "Madina Bank Account Statement\n"
+               << "Account:          " << accNum << "\n"
+               << "Period:           " << formatLocal(request.from, "%Y-%m-%d") << " to "
+               << formatLocal(request.to, "%Y-%m-%d") << "\n"
+               << "Opening balance:  " << balance << "\n\n"
+               << left << setw(21) << "Date" << setw(13) << "Type" << setw(16) << "Reference"
+               << right << setw(14) << "Debit" << setw(14) << "Credit" << setw(16) << "Balance" << "\n";
+        string out = header.str();
+        out.reserve(out.size() + entries.size() * 96 + 128);
+        char date[64];
+        for (uint32_t i : entries) {
+            const JournalRecord& r = records[i];
+            Money amount = Money::fromDouble(r.amount);
+            bool debit = r.fromAccount == accNum;
+            balance += debit ? -amount : amount;
+            clock.format(static_cast<time_t>(r.date), date);
+            appendPadded(out, date, 21, false);
+            appendPadded(out, r.transactionType, 13, false);
+            appendPadded(out, debit ? r.toAccount : r.fromAccount, 16, false);
+            appendPadded(out, debit ? amount.toString() : string(), 14, true);
+            appendPadded(out, debit ? string() : amount.toString(), 14, true);
+            appendPadded(out, balance.toString(), 16, true);
+            out += '\n';
+        }
+        out += "\nClosing balance:  " + closing.toString() + "\n"
+             + "Entries: " + to_string(entries.size()) + " | Debits: " + debits.toString()
+             + " | Credits: " + credits.toString() + "\n";
+
+        ofstream file(path, ios::binary | ios::trunc);
+        file << out;
+        if (!file) {
+            throw FileException("Cannot write statement: " + path);
+        }
+    }
+}
+
+StatementSummary Banking::writeStatements(const string& journalPath, const StatementRequest& request)
+{
+    auto start = chrono::steady_clock::now();
+    StatementSummary summary;
+    if (mkdir(request.outputDir.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw FileException("Cannot create statement directory: " + request.outputDir);
+    }
+    summary.threads = request.threads > 0 ? request.threads : max(1u, thread::hardware_concurrency());
+    summary.shards = summary.threads * shardsPerThread;
+
+    unordered_map<string, AccountTotals> accounts;
+    accounts.reserve(request.balances.size());
+    vector<vector<const string*>> accountsOf(summary.shards);
+    hash<string> hasher;
+    for (const auto& entry : request.balances) {
+        AccountTotals& totals = accounts[entry.first];
+        totals.balanceAtEnd = entry.second;
+        totals.shard = hasher(entry.first) % summary.shards;
+    }
+    for (const auto& entry : accounts) accountsOf[entry.second.shard].push_back(&entry.first);
+
+    // One pass over the journal: sum what came after the period, spill what is in it
+    {
+        vector<vector<char>> buffers(summary.shards, vector<char>(1 << 16));
+        vector<ofstream> shards(summary.shards);
+        for (size_t s = 0; s < summary.shards; s++) {
+            shards[s].rdbuf()->pubsetbuf(buffers[s].data(), buffers[s].size());
+            shards[s].open(shardPath(request.outputDir, s), ios::binary | ios::trunc);
+            if (!shards[s].is_open()) {
+                throw FileException("Cannot write statement shard in " + request.outputDir);
+            }
+        }
+        string frame;
+        // Nothing dated before the period matters, so those segments are never read
+        TransactionJournal& journal = TransactionJournal::shared(journalPath);
+        JournalRangeScan scan = journal.forEachInRange(request.from, INT64_MAX, [&](const JournalRecord& r, uint64_t) {
+            if (r.status != "Completed" || r.fromAccount == r.toAccount) return true;
+
+            auto from = accounts.find(r.fromAccount);
+            auto to = accounts.find(r.toAccount);
+            if (r.date > request.to) {
+                Money amount = Money::fromDouble(r.amount);
+                if (from != accounts.end()) from->second.afterPeriod -= amount;
+                if (to != accounts.end()) to->second.afterPeriod += amount;
+                return true;
+            }
+            size_t written = summary.shards;
+            for (auto it : {from, to}) {
+                if (it == accounts.end() || it->second.shard == written) continue;
+                frame.clear();
+                TransactionJournal::encode(r, frame);
+                shards[it->second.shard].write(frame.data(), frame.size());
+                written = it->second.shard;
+            }
+            return true;
+        }, request.journalEnd);
+        summary.journalRecords = scan.records;
+        summary.segmentsSkipped = scan.skipped;
+        for (auto& shard : shards) {
+            shard.close();
+            if (shard.fail()) throw FileException("Cannot write statement shard in " + request.outputDir);
+        }
+    }
+    auto scanned = chrono::steady_clock::now();
+    summary.scanMs = chrono::duration<double, milli>(scanned - start).count();
+
+    // Each thread takes whole shards, so an account's statement is built by one thread
+    atomic<size_t> nextShard(0);
+    atomic<size_t> statements(0), entries(0);
+    mutex failureMutex;
+    string failure;
+    auto worker = [&]() {
+        vector<JournalRecord> records;
+        unordered_map<string, vector<uint32_t>> entriesOf;
+        LocalClock clock;
+        for (size_t s = nextShard++; s < summary.shards; s = nextShard++) {
+            string path = shardPath(request.outputDir, s);
+            try {
+                records.clear();
+                entriesOf.clear();
+                TransactionJournal::forEach(path, [&records](const JournalRecord& r, uint64_t) {
+                    records.push_back(r);
+                    return true;
+                });
+                for (uint32_t i = 0; i < records.size(); i++) {
+                    for (const string* side : {&records[i].fromAccount, &records[i].toAccount}) {
+                        auto it = accounts.find(*side);
+                        if (it != accounts.end() && it->second.shard == s) entriesOf[*side].push_back(i);
+                    }
+                }
+                for (const string* accNum : accountsOf[s]) {
+                    vector<uint32_t>& list = entriesOf[*accNum];
+                    writeStatement(statementPath(request.outputDir, *accNum), *accNum, accounts.at(*accNum),
+                                   records, list, request, clock);
+                    statements++;
+                    entries += list.size();
+                }
+            } catch (const exception& e) {
+                lock_guard<mutex> lock(failureMutex);
+                if (failure.empty()) failure = e.what();
+            }
+            remove(path.c_str());
+        }
+    };
+    vector<thread> pool;
+    for (size_t t = 1; t < summary.threads; t++) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+    if (!failure.empty()) throw FileException(failure);
+
+    summary.statements = statements;
+    summary.entries = entries;
+    auto end = chrono::steady_clock::now();
+    summary.renderMs = chrono::duration<double, milli>(end - scanned).count();
+    summary.elapsedMs = chrono::duration<double, milli>(end - start).count();
+    return summary;
+}
@@ -0,0 +1,58 @@
+#ifndef STATEMENT_H
+#define STATEMENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+#include "money.h"
+
+// ----------------------------Account statements--------------------------------
+//
+// Statements for a period are rebuilt from the transaction journal and the balance each
+// account had when the journal ended, so no balance history has to be kept:
+//
+//     closing = balance at the journal end - movements after the period
+//     opening = closing - movements inside the period
+//
+// A record debits fromAccount and credits toAccount; only "Completed" records move
+// money. The journal is read once from the period on (segments dated wholly before it
+// are skipped, see segment.h): movements after the period are summed per account,
+// and records inside it are spilled into shard files (by a hash of the account) in the
+// output directory, so memory is bounded by one shard rather than the whole period. A
+// pool of threads then takes the shards one at a time and writes one file per account,
+// <outputDir>/<accountNumber>.txt.
+
+namespace Banking
+{
+    struct StatementRequest
+    {
+        time_t from = 0;
+        time_t to = 0;                      // inclusive
+        std::string outputDir;
+        size_t threads = 0;                 // 0 = one per hardware thread
+        std::vector<std::pair<std::string, Money>> balances;   // accounts and their balance at journalEnd
+        uint64_t journalEnd = UINT64_MAX;   // records at or past this offset are ignored
+    };
+
+    struct StatementSummary
+    {
+        size_t statements = 0;
+        size_t entries = 0;                 // statement lines (a transfer between two listed accounts counts twice)
+        size_t journalRecords = 0;          // records dated from the period on
+        size_t segmentsSkipped = 0;         // journal segments dated wholly before the period
+        size_t shards = 0;
+        size_t threads = 0;
+        double scanMs = 0;
+        double renderMs = 0;
+        double elapsedMs = 0;
+    };
+
+    // Write the statements of request.balances from the journal at journalPath. Throws
+    // FileException when the output directory or a file in it cannot be written.
+    StatementSummary writeStatements(const std::string& journalPath, const StatementRequest& request);
+}
+
+#endif // STATEMENT_H